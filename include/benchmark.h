@@ -0,0 +1,98 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+/*
+Benchmark mode and input recording for main.cpp.
+Exploration input is kept per frame as the held keys, the scroll amount and the clock (t, dt) that
+frame ran with, so a replay moves through exactly the same views as the recording did.
+BenchmarkStats collects frame times and pixel/iteration counts and writes them as JSON.
+*/
+
+// keys processInput acts on, as bits of InputFrame::keys
+enum InputKey {
+    INPUT_UP = 1,
+    INPUT_DOWN = 2,
+    INPUT_W = 4,
+    INPUT_S = 8,
+    INPUT_D = 16,
+    INPUT_A = 32,
+    INPUT_ENTER = 64,
+    INPUT_PAGE_UP = 128,
+    INPUT_PAGE_DOWN = 256
+};
+
+struct InputFrame {
+    float t = 0.0f;
+    float dt = 0.0f;
+    unsigned keys = 0;
+    double scroll = 0.0;    // scroll wheel offset since the previous frame
+};
+
+// text file, one "t dt keys scroll" line per frame
+struct InputLog {
+    std::vector<InputFrame> frames;
+
+    bool load(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) return false;
+        frames.clear();
+        InputFrame f;
+        while (file >> f.t >> f.dt >> f.keys >> f.scroll) frames.push_back(f);
+        return true;
+    }
+
+    bool save(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+        file.precision(9);
+        for (const InputFrame &f : frames) file << f.t << " " << f.dt << " " << f.keys << " " << f.scroll << "\n";
+        return (bool)file;
+    }
+};
+
+// nearest-rank percentile, p in [0, 100]
+inline double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p/100.0*values.size());
+    return values[std::min(values.size()-1, rank > 0 ? rank-1 : 0)];
+}
+
+struct BenchmarkStats {
+    std::vector<double> frameMs;
+    double pixels = 0.0;        // cube pass pixels over all frames
+    uint64_t iterations = 0;    // escape loop iterations over all frames
+
+    std::string json(int width, int height, int ssaa, int maxIters) const {
+        double total = 0.0;
+        for (double ms : frameMs) total += ms;
+        double seconds = total*1e-3;
+        std::ostringstream out;
+        out << "{\n";
+        out << "  \"frames\": " << frameMs.size() << ",\n";
+        out << "  \"width\": " << width << ",\n";
+        out << "  \"height\": " << height << ",\n";
+        out << "  \"ssaa\": " << ssaa << ",\n";
+        out << "  \"maxIters\": " << maxIters << ",\n";
+        out << "  \"total_ms\": " << total << ",\n";
+        out << "  \"mean_ms\": " << (frameMs.empty() ? 0.0 : total/frameMs.size()) << ",\n";
+        out << "  \"p50_ms\": " << percentile(frameMs, 50.0) << ",\n";
+        out << "  \"p95_ms\": " << percentile(frameMs, 95.0) << ",\n";
+        out << "  \"p99_ms\": " << percentile(frameMs, 99.0) << ",\n";
+        out << "  \"megapixels_per_s\": " << (seconds > 0.0 ? pixels*1e-6/seconds : 0.0) << ",\n";
+        out << "  \"iterations\": " << iterations << ",\n";
+        out << "  \"iterations_per_s\": " << (seconds > 0.0 ? double(iterations)/seconds : 0.0) << "\n";
+        out << "}\n";
+        return out.str();
+    }
+};
+
+#endif
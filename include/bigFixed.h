@@ -0,0 +1,106 @@
+#ifndef BIG_FIXED_H
+#define BIG_FIXED_H
+
+#include <cstdint>
+#include <cmath>
+
+/*
+Fixed point number with N 32-bit limbs, two's complement, little endian: d[N-1] is the integer part
+and the other limbs are the fraction, so the precision is 32*(N-1) bits after the point.
+Only what the mandelbrot iteration needs (add, subtract, multiply, conversion from/to double); used for
+reference orbits of the perturbation renderers where doubles run out below ~1e-15.
+*/
+
+template<int N>
+struct BigFixed {
+    uint32_t d[N];
+
+    BigFixed() {
+        for (int i=0; i<N; i++) d[i] = 0;
+    }
+
+    // v * 2^exp2, exact as long as the bits fit
+    static BigFixed fromDouble(double v, int exp2 = 0) {
+        BigFixed r;
+        if (v == 0.0 || !std::isfinite(v)) return r;
+        int e;
+        double m = std::frexp(std::fabs(v), &e);
+        uint64_t mant = (uint64_t)std::ldexp(m, 53);
+        // |v| * 2^exp2 = mant * 2^shift in units of the lowest limb
+        int shift = e - 53 + exp2 + 32*(N-1);
+        for (int bit=0; bit<53; bit++) {
+            if (!((mant >> bit) & 1)) continue;
+            int pos = bit + shift;
+            if (pos < 0 || pos >= 32*N-1) continue;
+            r.d[pos/32] |= 1u << (pos%32);
+        }
+        if (v < 0.0) r = -r;
+        return r;
+    }
+
+    bool negative() const {
+        return d[N-1] & 0x80000000u;
+    }
+
+    double toDouble() const {
+        BigFixed a = negative() ? -*this : *this;
+        double r = 0.0;
+        // three limbs hold more than the 53 bits of a double
+        for (int i=N-1; i>=0 && i>=N-3; i--) r += std::ldexp((double)a.d[i], 32*(i-(N-1)));
+        return negative() ? -r : r;
+    }
+
+    BigFixed operator-() const {
+        BigFixed r;
+        uint64_t carry = 1;
+        for (int i=0; i<N; i++) {
+            uint64_t t = (uint64_t)(~d[i]) + carry;
+            r.d[i] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        return r;
+    }
+
+    BigFixed operator+(const BigFixed &b) const {
+        BigFixed r;
+        uint64_t carry = 0;
+        for (int i=0; i<N; i++) {
+            uint64_t t = (uint64_t)d[i] + b.d[i] + carry;
+            r.d[i] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        return r;
+    }
+
+    BigFixed operator-(const BigFixed &b) const {
+        return *this + (-b);
+    }
+
+    BigFixed operator*(const BigFixed &b) const {
+        bool neg = negative() != b.negative();
+        BigFixed x = negative() ? -*this : *this;
+        BigFixed y = b.negative() ? -b : b;
+        // only the limbs that end up at or above the lowest kept limb (plus one for the carries)
+        uint32_t prod[2*N] = {};
+        for (int i=0; i<N; i++) {
+            if (x.d[i] == 0) continue;
+            uint64_t carry = 0;
+            int j0 = N-2-i > 0 ? N-2-i : 0;
+            for (int j=j0; j<N; j++) {
+                uint64_t t = (uint64_t)x.d[i]*y.d[j] + prod[i+j] + carry;
+                prod[i+j] = (uint32_t)t;
+                carry = t >> 32;
+            }
+            for (int k=i+N; carry && k<2*N; k++) {
+                uint64_t t = (uint64_t)prod[k] + carry;
+                prod[k] = (uint32_t)t;
+                carry = t >> 32;
+            }
+        }
+        BigFixed r;
+        for (int i=0; i<N; i++) r.d[i] = prod[i+N-1];
+        return neg ? -r : r;
+    }
+};
+
+#endif
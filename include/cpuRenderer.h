@@ -0,0 +1,327 @@
+#ifndef CPU_RENDERER_H
+#define CPU_RENDERER_H
+
+#include "glm/glm.hpp"
+#include "scene.h"
+#include "escape.h"
+#include "simdEscape.h"
+#include "tileScheduler.h"
+#include "solidGuess.h"
+#include "deepZoom.h"
+#include "zoomLevels.h"
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <cstdint>
+#include <cmath>
+
+/*
+Software version of the cube pass: rasterizes cube[] with the same mat/effectMat/zoom/pos uniforms
+as vShader32.glsl and runs the fShader32.glsl escape loop once per visible pixel.
+Needs no window or GL context, so it runs on machines without a GPU and gives a reference image to
+compare the GPU output against.
+Below deepZoom the escape loop is replaced by the perturbation/BLA engine in deepZoom.h.
+*/
+
+// colour, depth and iteration buffers of one frame, rows bottom to top like a GL texture
+struct CpuImage {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> colour;
+    std::vector<float> depth;
+    std::vector<int> iters;     // -1 where the cube does not cover the pixel
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        colour.assign(size_t(w)*h, glm::vec3(0.0f));
+        depth.assign(size_t(w)*h, 1.0f);
+        iters.assign(size_t(w)*h, -1);
+    }
+};
+
+// one cube triangle after the vertex shader and viewport transform
+struct RasterTri {
+    glm::vec2 s[3];     // window coordinates
+    float z[3];         // depth in [0, 1]
+    float invW[3];
+    glm::vec2 frag[3];  // FragPos.xy
+    glm::vec2 unit[3];  // (FragPos.xy - pos)/zoom, for the deep zoom engine
+    float area;
+    int minX, minY, maxX, maxY;
+    int face;
+};
+
+inline float edgeFn(glm::vec2 a, glm::vec2 b, glm::vec2 p) {
+    return (b.x-a.x)*(p.y-a.y) - (b.y-a.y)*(p.x-a.x);
+}
+
+// runs the vertex stage of vShader32.glsl on all 36 cube vertices
+inline std::vector<RasterTri> setupTriangles(const Frame &f, int width, int height) {
+    std::vector<RasterTri> tris;
+    for (int i=0; i<12; i++) {
+        RasterTri tri;
+        bool behind = false;
+        for (int v=0; v<3; v++) {
+            const float *a = &cube[(i*3+v)*8];
+            glm::vec4 aPos(a[0], a[1], a[2], 1.0f);
+            glm::vec4 clip = f.mat*aPos;
+            if (clip.w <= 0.0f) behind = true;
+            glm::vec3 ndc = glm::vec3(clip)/clip.w;
+            tri.s[v] = glm::vec2((ndc.x*0.5f+0.5f)*width, (ndc.y*0.5f+0.5f)*height);
+            tri.z[v] = ndc.z*0.5f+0.5f;
+            tri.invW[v] = 1.0f/clip.w;
+            glm::vec4 fragPos = (float)f.zoom*f.effectMat*aPos + glm::vec4(glm::vec2(f.pos), 0.0f, 1.0f);
+            tri.frag[v] = glm::vec2(fragPos);
+            tri.unit[v] = glm::vec2(f.effectMat*aPos);
+        }
+        tri.area = edgeFn(tri.s[0], tri.s[1], tri.s[2]);
+        if (behind || tri.area == 0.0f) continue;
+        float loX = std::min({tri.s[0].x, tri.s[1].x, tri.s[2].x});
+        float hiX = std::max({tri.s[0].x, tri.s[1].x, tri.s[2].x});
+        float loY = std::min({tri.s[0].y, tri.s[1].y, tri.s[2].y});
+        float hiY = std::max({tri.s[0].y, tri.s[1].y, tri.s[2].y});
+        tri.minX = std::max(0, (int)std::floor(loX));
+        tri.minY = std::max(0, (int)std::floor(loY));
+        tri.maxX = std::min(width-1, (int)std::ceil(hiX));
+        tri.maxY = std::min(height-1, (int)std::ceil(hiY));
+        tri.face = i/2;
+        tris.push_back(tri);
+    }
+    return tris;
+}
+
+// nearest triangle covering pixel (x, y), -1 if none; bary gets perspective-correct weights
+inline int resolvePixel(const std::vector<RasterTri> &tris, int x, int y, glm::vec3 &bary, float &depth) {
+    glm::vec2 p(x+0.5f, y+0.5f);
+    int hit = -1;
+    depth = 1.0f;
+    for (size_t i=0; i<tris.size(); i++) {
+        const RasterTri &tri = tris[i];
+        if (x < tri.minX || x > tri.maxX || y < tri.minY || y > tri.maxY) continue;
+        float b0 = edgeFn(tri.s[1], tri.s[2], p)/tri.area;
+        float b1 = edgeFn(tri.s[2], tri.s[0], p)/tri.area;
+        float b2 = edgeFn(tri.s[0], tri.s[1], p)/tri.area;
+        if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) continue;
+        float z = b0*tri.z[0] + b1*tri.z[1] + b2*tri.z[2];
+        if (z >= depth) continue;   // GL_LESS against a cleared depth of 1.0
+        depth = z;
+        hit = (int)i;
+        glm::vec3 w(b0*tri.invW[0], b1*tri.invW[1], b2*tri.invW[2]);
+        bary = w/(w.x + w.y + w.z);
+    }
+    return hit;
+}
+
+inline glm::vec2 interpolateFrag(const RasterTri &tri, glm::vec3 bary) {
+    return bary.x*tri.frag[0] + bary.y*tri.frag[1] + bary.z*tri.frag[2];
+}
+
+inline glm::vec2 interpolateUnit(const RasterTri &tri, glm::vec3 bary) {
+    return bary.x*tri.unit[0] + bary.y*tri.unit[1] + bary.z*tri.unit[2];
+}
+
+// largest |FragPos.xy - pos|/zoom on the cube, bounds the dc of every pixel
+inline double maxUnitOffset(const Frame &f) {
+    double r = 0.0;
+    for (int i=0; i<36; i++) {
+        const float *a = &cube[i*8];
+        glm::vec2 u = glm::vec2(f.effectMat*glm::vec4(a[0], a[1], a[2], 1.0f));
+        r = std::max(r, (double)glm::length(u));
+    }
+    return r;
+}
+
+class CpuRenderer {
+public:
+    TileScheduler scheduler;
+    int tileSize;
+    TileOrder order;
+    SimdLevel simd;
+    bool guess;     // solid guessing, see solidGuess.h
+    std::atomic<long long> guessed;
+    double deepZoom;    // zoom below which deepZoom.h takes over, 0 never uses it
+    std::atomic<long long> skipped;     // iterations skipped by BLA in the last deep frame
+    DeepZoom<double> deep;
+    DeepZoom<FloatExp> deepExp;
+
+    CpuRenderer(int threads = 0, int tileSize = 32) : scheduler(threads), tileSize(tileSize), order(ORDER_HILBERT), simd(detectSimd()), guess(false), guessed(0), deepZoom(1e-5), skipped(0)
+    {
+    }
+
+    void render(const Frame &f, CpuImage &img) {
+        std::vector<RasterTri> tris = setupTriangles(f, img.width, img.height);
+        std::vector<Tile> tiles = makeTiles(img.width, img.height, tileSize, order);
+        guessed = 0;
+        skipped = 0;
+        if (f.zoom < deepZoom) {
+            // doubles hold the deltas and BLA coefficients down to about 2^-900
+            if (f.scaled.exponent > -900) {
+                deep.prepare(f, maxUnitOffset(f));
+                scheduler.run(tiles, [&](const Tile &tile, int) {
+                    renderTileDeep(deep, f, tris, img, tile);
+                });
+            }
+            else {
+                deepExp.prepare(f, maxUnitOffset(f));
+                scheduler.run(tiles, [&](const Tile &tile, int) {
+                    renderTileDeep(deepExp, f, tris, img, tile);
+                });
+            }
+            return;
+        }
+        scheduler.run(tiles, [&](const Tile &tile, int) {
+            if (guess) renderTileGuess(f, tris, img, tile);
+            else renderTile(f, tris, img, tile);
+        });
+    }
+
+    // colours resampled from precomputed zoom levels (zoomLevels.h) instead of the escape loop: coarse holds
+    // every c of the frame, fine (one level deeper, may be null) is blended in with fineWeight where it has c
+    void renderResampled(const Frame &f, CpuImage &img, const ZoomLevel &coarse, const ZoomLevel *fine, float fineWeight) {
+        std::vector<RasterTri> tris = setupTriangles(f, img.width, img.height);
+        std::vector<Tile> tiles = makeTiles(img.width, img.height, tileSize, order);
+        scheduler.run(tiles, [&](const Tile &tile, int) {
+            for (int y=tile.y0; y<tile.y1; y++) {
+                for (int x=tile.x0; x<tile.x1; x++) {
+                    size_t idx = size_t(y)*img.width + x;
+                    glm::vec3 bary;
+                    int hit = resolvePixel(tris, x, y, bary, img.depth[idx]);
+                    if (hit < 0) {
+                        img.colour[idx] = glm::vec3(0.0f);
+                        img.iters[idx] = -1;
+                        continue;
+                    }
+                    // c in double from the unit offset, the levels are finer than a float c resolves
+                    glm::dvec2 c = f.pos + f.zoom*glm::dvec2(interpolateUnit(tris[hit], bary));
+                    glm::vec3 colour(0.0f), detail(0.0f);
+                    zoomLevelColour(coarse, c, f.maxIters, f.banding, f.c1, f.c2, colour);
+                    if (fine && zoomLevelColour(*fine, c, f.maxIters, f.banding, f.c1, f.c2, detail)) {
+                        colour += fineWeight*(detail - colour);
+                    }
+                    img.colour[idx] = colour;
+                    img.iters[idx] = zoomLevelIters(coarse, c);
+                }
+            }
+        });
+    }
+
+    void renderTile(const Frame &f, const std::vector<RasterTri> &tris, CpuImage &img, const Tile &tile) {
+        // gather the c of every covered pixel, then run them through the escape kernel in one batch
+        std::vector<float> cx, cy;
+        std::vector<int> index, iters;
+        for (int y=tile.y0; y<tile.y1; y++) {
+            for (int x=tile.x0; x<tile.x1; x++) {
+                size_t idx = size_t(y)*img.width + x;
+                glm::vec3 bary;
+                float depth;
+                int hit = resolvePixel(tris, x, y, bary, depth);
+                img.depth[idx] = depth;
+                if (hit < 0) {
+                    img.colour[idx] = glm::vec3(0.0f);
+                    img.iters[idx] = -1;
+                    continue;
+                }
+                glm::vec2 c = interpolateFrag(tris[hit], bary);
+                cx.push_back(c.x);
+                cy.push_back(c.y);
+                index.push_back((int)idx);
+            }
+        }
+        iters.resize(index.size());
+        escapeBatchFor(simd)(cx.data(), cy.data(), iters.data(), (int)index.size(), f.maxIters);
+        for (size_t p=0; p<index.size(); p++) {
+            img.iters[index[p]] = iters[p];
+            img.colour[index[p]] = bandColour(iters[p], f.maxIters, f.banding, f.c1, f.c2);
+        }
+    }
+
+    template<typename T>
+    void renderTileDeep(const DeepZoom<T> &engine, const Frame &f, const std::vector<RasterTri> &tris, CpuImage &img, const Tile &tile) {
+        long long tileSkipped = 0;
+        for (int y=tile.y0; y<tile.y1; y++) {
+            for (int x=tile.x0; x<tile.x1; x++) {
+                size_t idx = size_t(y)*img.width + x;
+                glm::vec3 bary;
+                int hit = resolvePixel(tris, x, y, bary, img.depth[idx]);
+                if (hit < 0) {
+                    img.colour[idx] = glm::vec3(0.0f);
+                    img.iters[idx] = -1;
+                    continue;
+                }
+                int iters = engine.iterate(interpolateUnit(tris[hit], bary), f.maxIters, tileSkipped);
+                img.iters[idx] = iters;
+                img.colour[idx] = bandColour(iters, f.maxIters, f.banding, f.c1, f.c2);
+            }
+        }
+        skipped += tileSkipped;
+    }
+
+    void renderTileGuess(const Frame &f, const std::vector<RasterTri> &tris, CpuImage &img, const Tile &tile) {
+        GuessTile g;
+        g.resize(tile.x1-tile.x0, tile.y1-tile.y0);
+        for (int y=tile.y0; y<tile.y1; y++) {
+            for (int x=tile.x0; x<tile.x1; x++) {
+                int p = (y-tile.y0)*g.width + x-tile.x0;
+                glm::vec3 bary;
+                int hit = resolvePixel(tris, x, y, bary, img.depth[size_t(y)*img.width + x]);
+                if (hit < 0) continue;
+                glm::vec2 c = interpolateFrag(tris[hit], bary);
+                g.face[p] = tris[hit].face;
+                g.cx[p] = c.x;
+                g.cy[p] = c.y;
+            }
+        }
+        SolidGuess(escapeBatchFor(simd), f.maxIters).run(g);
+        guessed += g.guessed;
+        for (int y=tile.y0; y<tile.y1; y++) {
+            for (int x=tile.x0; x<tile.x1; x++) {
+                size_t idx = size_t(y)*img.width + x;
+                int iters = g.iters[(y-tile.y0)*g.width + x-tile.x0];
+                img.iters[idx] = iters;
+                if (iters < 0) img.colour[idx] = glm::vec3(0.0f);
+                else img.colour[idx] = bandColour(iters, f.maxIters, f.banding, f.c1, f.c2);
+            }
+        }
+    }
+};
+
+// box filter down to the window size, what the screen pass does for ssaa 2 with its linear tap
+inline void downsample(const CpuImage &src, CpuImage &dst, int ssaa) {
+    dst.resize(src.width/ssaa, src.height/ssaa);
+    float inv = 1.0f/float(ssaa*ssaa);
+    for (int y=0; y<dst.height; y++) {
+        for (int x=0; x<dst.width; x++) {
+            glm::vec3 sum(0.0f);
+            for (int j=0; j<ssaa; j++) {
+                for (int i=0; i<ssaa; i++) {
+                    sum += src.colour[size_t(y*ssaa+j)*src.width + x*ssaa+i];
+                }
+            }
+            dst.colour[size_t(y)*dst.width + x] = sum*inv;
+        }
+    }
+}
+
+// binary PPM, flipped so the image is upright
+inline bool writePPM(const std::string &path, const CpuImage &img) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file << "P6\n" << img.width << " " << img.height << "\n255\n";
+    std::vector<uint8_t> row(size_t(img.width)*3);
+    for (int y=img.height-1; y>=0; y--) {
+        for (int x=0; x<img.width; x++) {
+            glm::vec3 c = glm::clamp(img.colour[size_t(y)*img.width + x], 0.0f, 1.0f);
+            row[x*3+0] = (uint8_t)(c.x*255.0f + 0.5f);
+            row[x*3+1] = (uint8_t)(c.y*255.0f + 0.5f);
+            row[x*3+2] = (uint8_t)(c.z*255.0f + 0.5f);
+        }
+        file.write((const char*)row.data(), row.size());
+    }
+    return (bool)file;
+}
+
+#endif
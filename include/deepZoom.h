@@ -0,0 +1,163 @@
+#ifndef DEEP_ZOOM_H
+#define DEEP_ZOOM_H
+
+#include "glm/glm.hpp"
+#include "scene.h"
+#include "escape.h"
+#include "perturbation.h"
+#include "floatExp.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/*
+CPU deep zoom engine: perturbation against one reference orbit at pos, with bilinear approximation
+(BLA) to skip iterations.
+While dz is small next to Z the step dz' = 2*Z*dz + dz^2 + dc is linear in dz and dc, so 2^l steps
+from reference iteration m collapse to dz' = A*dz + B*dc. The table holds A, B and the radius |dz|
+has to stay under for every power of two run of the orbit, built by merging pairs; a pixel takes the
+longest run that is valid for it and falls back to single steps where none is.
+Instead of glitch detection and extra references the pixel is rebased onto the start of the orbit
+whenever |z| drops below |dz| or it runs past the end of the reference (Zhuoran's method).
+Deltas are double down to a zoom of ~2^-900 and FloatExp (floatExp.h) below that.
+*/
+
+template<typename T>
+struct Bla {
+    Complex<T> a, b;
+    T r2;       // squared radius of |dz| for which the approximation holds
+};
+
+template<typename T>
+class DeepZoom {
+public:
+    // allowed relative size of the dropped dz^2 term; smaller is more exact and skips less
+    double epsilon = std::ldexp(1.0, -24);
+
+    ReferenceOrbit orbit;
+    std::vector<std::vector<Bla<T>>> levels;   // levels[l-1][j] covers the 2^l steps from m = 1 + j*2^l
+    Complex<T> scale;       // dc of a pixel is scale times its offset (FragPos - pos)/zoom
+    bool cardioidCheck;
+    glm::dvec2 pos;
+    double zoom;
+
+    // reference orbit and BLA table for one frame
+    void prepare(const Frame &f, double dcMax) {
+        pos = f.pos;
+        zoom = f.zoom;
+        T s = T(f.scaled.mantissa);
+        s = ldexpT(s, f.scaled.exponent);
+        scale = Complex<T>(s, T(0.0));
+        // c in doubles only tells cardioid points apart while the pixels are far above double precision
+        cardioidCheck = f.scaled.exponent > -45;
+        orbit = referenceOrbit(f.pos, glm::dvec2(0.0), 0, f.maxIters, f.scaled.exponent);
+        buildTable(s*T(dcMax));
+    }
+
+    // escape time of the pixel at unscaled offset u from pos, same meaning as escapeIters
+    int iterate(glm::vec2 u, int maxIters, long long &skipped) const {
+        if (cardioidCheck && maxIters > 0 && inCardioidOrBulbD(pos.x + u.x*zoom, pos.y + u.y*zoom)) return maxIters-1;
+        Complex<T> dc = scale*Complex<T>(T(u.x), T(u.y));
+        const std::vector<glm::dvec2> &Z = orbit.z;
+        int last = (int)Z.size()-1;
+        Complex<T> dz;
+        int m = 0;
+        int n = 0;
+        int iters = 0;
+        while (n < maxIters) {
+            int steps = 0;
+            if (m > 0) {
+                T r2 = dz.norm();
+                for (int l=(int)levels.size(); l>0; l--) {
+                    if ((m-1) & ((1 << l)-1)) continue;
+                    size_t j = size_t(m-1) >> l;
+                    if (j >= levels[l-1].size() || n + (1 << l) > maxIters) continue;
+                    const Bla<T> &b = levels[l-1][j];
+                    if (!(r2 < b.r2)) continue;
+                    dz = b.a*dz + b.b*dc;
+                    steps = 1 << l;
+                    break;
+                }
+            }
+            if (steps == 0) {
+                Complex<T> Zm(T(Z[m].x), T(Z[m].y));
+                dz = Zm*dz*T(2.0) + dz*dz + dc;
+                steps = 1;
+            }
+            else skipped += steps;
+            m += steps;
+            n += steps;
+            Complex<T> z = Complex<T>(T(Z[m].x), T(Z[m].y)) + dz;
+            double zn = toDouble(z.norm());
+            if (zn > 4.0) {
+                // the last step that did not escape, as in the shader
+                iters = std::max(0, n-2);
+                break;
+            }
+            iters = n-1;
+            if (m == last || z.norm() < dz.norm()) {
+                dz = z;
+                m = 0;
+            }
+        }
+        return iters;
+    }
+
+private:
+    static double ldexpT(double v, int e) {
+        return std::ldexp(v, e);
+    }
+
+    static FloatExp ldexpT(const FloatExp &v, int e) {
+        return ldexp(v, e);
+    }
+
+    static T magnitude(const Complex<T> &v) {
+        using std::sqrt;
+        return sqrt(v.norm());
+    }
+
+    Bla<T> single(int m) const {
+        Bla<T> b;
+        Complex<T> Zm(T(orbit.z[m].x), T(orbit.z[m].y));
+        b.a = Zm*T(2.0);
+        b.b = Complex<T>(T(1.0), T(0.0));
+        T r = magnitude(Zm)*T(epsilon);
+        b.r2 = r*r;
+        return b;
+    }
+
+    // x followed by y
+    static Bla<T> merge(const Bla<T> &x, const Bla<T> &y, T dcMax) {
+        using std::sqrt;
+        using std::max;
+        using std::min;
+        Bla<T> b;
+        b.a = y.a*x.a;
+        b.b = y.a*x.b + y.b;
+        T ax = magnitude(x.a);
+        T rx = sqrt(x.r2);
+        T ry = sqrt(y.r2);
+        T r = min(rx, max(T(0.0), (ry - magnitude(x.b)*dcMax)/ax));
+        b.r2 = r*r;
+        return b;
+    }
+
+    void buildTable(T dcMax) {
+        levels.clear();
+        // steps m -> m+1 for m = 1 .. last-1; the first step from Z_0 = 0 is always done exactly
+        int count = (int)orbit.z.size()-2;
+        if (count < 2) return;
+        std::vector<Bla<T>> prev(count);
+        for (int m=1; m<=count; m++) prev[m-1] = single(m);
+        while (prev.size() >= 2) {
+            std::vector<Bla<T>> next(prev.size()/2);
+            for (size_t j=0; j<next.size(); j++) next[j] = merge(prev[2*j], prev[2*j+1], dcMax);
+            levels.push_back(next);
+            prev.swap(next);
+        }
+    }
+};
+
+#endif
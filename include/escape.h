@@ -0,0 +1,106 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include "glm/glm.hpp"
+
+/*
+CPU versions of the escape-time loop and colouring in fShader32.glsl.
+escapeIters returns the same value the shader ends up with in "iters": the last iteration that did
+not escape, so a pixel that never escapes gives maxIters-1.
+Points in the main cardioid or period-2 bulb are answered without iterating, and Brent's cycle
+detection stops the loop once the orbit comes back to a saved point, since it can then never escape.
+The orbit has to hit the saved point exactly: the loop is deterministic so an exact repeat is a real
+cycle, while any tolerance also catches escaping orbits that pass close by (one pixel at the
+default shot with 1e-7), and the output has to stay the same as without the shortcuts.
+*/
+
+// iterations before the first saved point, doubled every time it is replaced
+const int periodStart = 8;
+
+// main cardioid and period-2 bulb, points inside never escape
+inline bool inCardioidOrBulb(float cx, float cy) {
+    float x = cx - 0.25f;
+    float q = x*x + cy*cy;
+    if (q*(q + x) <= 0.25f*cy*cy) return true;
+    return (cx+1.0f)*(cx+1.0f) + cy*cy <= 0.0625f;
+}
+
+inline bool inCardioidOrBulbD(double cx, double cy) {
+    double x = cx - 0.25;
+    double q = x*x + cy*cy;
+    if (q*(q + x) <= 0.25*cy*cy) return true;
+    return (cx+1.0)*(cx+1.0) + cy*cy <= 0.0625;
+}
+
+inline int escapeIters(float cx, float cy, int maxIters) {
+    if (maxIters > 0 && inCardioidOrBulb(cx, cy)) return maxIters-1;
+    float zx = 0.0f;
+    float zy = 0.0f;
+    float savedX = 0.0f;
+    float savedY = 0.0f;
+    int period = 0;
+    int limit = periodStart;
+    int iters = 0;
+    for (int i=0; i<maxIters; i++) {
+        float x = zx*zx - zy*zy + cx;
+        float y = 2.0f*zx*zy + cy;
+        zx = x;
+        zy = y;
+        if (zx*zx + zy*zy > 4.0f) {
+            break;
+        }
+        iters = i;
+        if (zx == savedX && zy == savedY) return maxIters-1;
+        if (++period == limit) {
+            period = 0;
+            limit *= 2;
+            savedX = zx;
+            savedY = zy;
+        }
+    }
+    return iters;
+}
+
+// double precision version, used as a reference for the float kernels
+inline int escapeItersD(double cx, double cy, int maxIters) {
+    if (maxIters > 0 && inCardioidOrBulbD(cx, cy)) return maxIters-1;
+    double zx = 0.0;
+    double zy = 0.0;
+    double savedX = 0.0;
+    double savedY = 0.0;
+    int period = 0;
+    int limit = periodStart;
+    int iters = 0;
+    for (int i=0; i<maxIters; i++) {
+        double x = zx*zx - zy*zy + cx;
+        double y = 2.0*zx*zy + cy;
+        zx = x;
+        zy = y;
+        if (zx*zx + zy*zy > 4.0) {
+            break;
+        }
+        iters = i;
+        if (zx == savedX && zy == savedY) return maxIters-1;
+        if (++period == limit) {
+            period = 0;
+            limit *= 2;
+            savedX = zx;
+            savedY = zy;
+        }
+    }
+    return iters;
+}
+
+// banding lerp factor between c1 and c2
+inline float bandT(int iters, int maxIters, int banding) {
+    if (iters == maxIters-1) return 1.0f;
+    if (banding <= 0) return 0.0f;
+    return float(iters % banding)/float(banding);
+}
+
+inline glm::vec3 bandColour(int iters, int maxIters, int banding, glm::vec3 c1, glm::vec3 c2) {
+    float t = bandT(iters, maxIters, banding);
+    return glm::vec3(c1.x + t*(c2.x-c1.x), c1.y + t*(c2.y-c1.y), c1.z + t*(c2.z-c1.z));
+}
+
+#endif
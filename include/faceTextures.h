@@ -0,0 +1,117 @@
+#ifndef FACE_TEXTURES_H
+#define FACE_TEXTURES_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "scene.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+/*
+Per face rendering: every face of the cube is a rectangle of the mandelbrot plane (facePlane in scene.h),
+so the faces turned towards the camera are rendered flat into a texture each, sized to the area they
+cover on screen, and the cube is then drawn textured from their mipmaps.
+The escape kernels then run once per texel instead of once per (supersampled) pixel, and minification
+is filtered by the mipmaps and anisotropic filtering instead of ssaa.
+A face is only rendered again when its plane, size or colours change.
+*/
+
+// everything the image of a face depends on
+struct FaceInputs {
+    FacePlane plane;
+    glm::ivec2 size;
+    int maxIters;
+    glm::vec3 c1, c2;
+    int banding;
+
+    bool operator==(const FaceInputs &other) const = default;
+};
+
+class FaceTextures {
+public:
+    GLuint fbo = 0;
+    GLuint tex[6] = {0, 0, 0, 0, 0, 0};
+    glm::ivec2 size[6];
+    // inputs each texture was last rendered with
+    FaceInputs last[6] = {};
+    // samples of anisotropic filtering, capped at what the driver supports
+    float anisotropy = 8.0f;
+
+    ~FaceTextures() {
+        release();
+    }
+
+    // true if the face turns towards the camera of mat (projection * view * model)
+    static bool facing(const glm::mat4 &mat, int face) {
+        glm::vec3 p00, p10, p01, normal;
+        faceCorners(face, p00, p10, p01, normal);
+        // the eye is where the perspective projection sends everything to w = 0 at x = y = 0
+        glm::vec4 eye = glm::inverse(mat)*glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+        if (std::abs(eye.w) < 1e-12f) return true;
+        glm::vec3 centre = 0.5f*normal;
+        return glm::dot(normal, glm::vec3(eye)/eye.w - centre) > 0.0f;
+    }
+
+    // texels across u and v for a face to cover at least one per window pixel
+    static glm::ivec2 textureSize(const glm::mat4 &mat, int face, int scrX, int scrY, int maxSize) {
+        glm::vec3 p00, p10, p01, normal;
+        faceCorners(face, p00, p10, p01, normal);
+        glm::vec3 p11 = p10 + p01 - p00;
+        glm::vec3 corners[4] = {p00, p10, p01, p11};
+        glm::vec2 screen[4];
+        for (int i=0; i<4; i++) {
+            glm::vec4 clip = mat*glm::vec4(corners[i], 1.0f);
+            // a corner behind the camera, the face could cover anything
+            if (clip.w <= 1e-6f) return glm::ivec2(maxSize);
+            screen[i] = (glm::vec2(clip)/clip.w*0.5f + 0.5f)*glm::vec2(scrX, scrY);
+        }
+        float u = std::max(glm::length(screen[1] - screen[0]), glm::length(screen[3] - screen[2]));
+        float v = std::max(glm::length(screen[2] - screen[0]), glm::length(screen[3] - screen[1]));
+        return glm::clamp(glm::ivec2(glm::ceil(glm::vec2(u, v))), glm::ivec2(1), glm::ivec2(maxSize));
+    }
+
+    // (re)allocates the texture of a face with a full mip chain, returns true if it did
+    bool allocate(int face, glm::ivec2 s) {
+        if (tex[face] != 0 && size[face] == s) return false;
+        if (fbo == 0) glGenFramebuffers(1, &fbo);
+        if (tex[face] != 0) glDeleteTextures(1, &tex[face]);
+        size[face] = s;
+        last[face] = {};
+        int levels = 1 + (int)std::floor(std::log2((float)std::max(s.x, s.y)));
+        glGenTextures(1, &tex[face]);
+        glBindTexture(GL_TEXTURE_2D, tex[face]);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA16F, s.x, s.y);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        GLfloat maxAniso = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAniso);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, std::min(anisotropy, maxAniso));
+        return true;
+    }
+
+    // binds fbo with level 0 of a face's texture attached, and its viewport
+    void bind(int face) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex[face], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Face FBO not complete.\n";
+        }
+        glViewport(0, 0, size[face].x, size[face].y);
+    }
+
+    void release() {
+        if (fbo == 0) return;
+        glDeleteFramebuffers(1, &fbo);
+        for (GLuint &t : tex) {
+            if (t != 0) glDeleteTextures(1, &t);
+            t = 0;
+        }
+        fbo = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef FLOAT_EXP_H
+#define FLOAT_EXP_H
+
+#include <cmath>
+#include <algorithm>
+
+/*
+Floating point number with a double mantissa and a separate int exponent: m * 2^e with |m| in
+[0.5, 1) (or m == 0). Covers the deltas and approximation coefficients of deep zooms, which go far
+past the 1e-308 where doubles underflow. Much slower than double, so the deep zoom engine only uses
+it when it has to (see deepZoom.h).
+Complex<T> is the small complex type the engine is written against, for T = double or FloatExp.
+*/
+
+struct FloatExp {
+    double m;
+    int e;
+
+    FloatExp() : m(0.0), e(0)
+    {
+    }
+
+    FloatExp(double v) {
+        m = std::frexp(v, &e);
+    }
+
+    // m * 2^e for any m, normalized
+    static FloatExp make(double m, int e) {
+        FloatExp r(m);
+        if (r.m != 0.0) r.e += e;
+        else r.e = 0;
+        return r;
+    }
+
+    double toDouble() const {
+        return std::ldexp(m, e);
+    }
+
+    FloatExp operator-() const {
+        FloatExp r = *this;
+        r.m = -r.m;
+        return r;
+    }
+
+    FloatExp operator*(const FloatExp &b) const {
+        return make(m*b.m, e+b.e);
+    }
+
+    FloatExp operator/(const FloatExp &b) const {
+        return make(m/b.m, e-b.e);
+    }
+
+    FloatExp operator+(const FloatExp &b) const {
+        if (m == 0.0) return b;
+        if (b.m == 0.0) return *this;
+        // the smaller one vanishes below the last mantissa bit
+        if (e - b.e > 60) return *this;
+        if (b.e - e > 60) return b;
+        if (e >= b.e) return make(m + std::ldexp(b.m, b.e-e), e);
+        return make(std::ldexp(m, e-b.e) + b.m, b.e);
+    }
+
+    FloatExp operator-(const FloatExp &b) const {
+        return *this + (-b);
+    }
+
+    FloatExp &operator+=(const FloatExp &b) {
+        return *this = *this + b;
+    }
+
+    FloatExp &operator*=(const FloatExp &b) {
+        return *this = *this * b;
+    }
+
+    bool operator<(const FloatExp &b) const {
+        if ((m < 0.0) != (b.m < 0.0) || m == 0.0 || b.m == 0.0) return m < b.m;
+        if (e != b.e) return (e < b.e) != (m < 0.0);
+        return m < b.m;
+    }
+
+    bool operator>(const FloatExp &b) const {
+        return b < *this;
+    }
+};
+
+inline double toDouble(double v) {
+    return v;
+}
+
+inline double toDouble(const FloatExp &v) {
+    return v.toDouble();
+}
+
+inline FloatExp sqrt(const FloatExp &v) {
+    // keep the exponent even so it halves exactly
+    int e = v.e & ~1;
+    return FloatExp::make(std::sqrt(std::ldexp(v.m, v.e-e)), e/2);
+}
+
+inline FloatExp ldexp(const FloatExp &v, int e) {
+    return FloatExp::make(v.m, v.e+e);
+}
+
+inline FloatExp max(const FloatExp &a, const FloatExp &b) {
+    return a < b ? b : a;
+}
+
+inline FloatExp min(const FloatExp &a, const FloatExp &b) {
+    return b < a ? b : a;
+}
+
+template<typename T>
+struct Complex {
+    T x, y;
+
+    Complex() : x(0.0), y(0.0)
+    {
+    }
+
+    Complex(T x, T y) : x(x), y(y)
+    {
+    }
+
+    Complex operator+(const Complex &b) const {
+        return Complex(x+b.x, y+b.y);
+    }
+
+    Complex operator-(const Complex &b) const {
+        return Complex(x-b.x, y-b.y);
+    }
+
+    Complex operator*(const Complex &b) const {
+        return Complex(x*b.x - y*b.y, x*b.y + y*b.x);
+    }
+
+    Complex operator*(const T &s) const {
+        return Complex(x*s, y*s);
+    }
+
+    // squared magnitude
+    T norm() const {
+        return x*x + y*y;
+    }
+};
+
+#endif
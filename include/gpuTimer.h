@@ -0,0 +1,160 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "glad/glad.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+/*
+GPU time of each pass of the render loop, from GL_TIME_ELAPSED queries plus a GL_TIMESTAMP at the
+start of every frame.
+Queries go into a ring of `latency` frames and a frame's results are only read when its slot comes
+round again, several frames later, by which time the GPU is normally done with them. A slot whose
+results are still not available is dropped rather than waited for, so timing never stalls the
+pipeline. Results are written one line per pass to a .csv file or as one object per frame to a .json
+file.
+*/
+
+class GpuTimer {
+public:
+    GpuTimer(int latency = 4, int maxPasses = 8) : latency(latency), maxPasses(maxPasses)
+    {
+    }
+
+    ~GpuTimer() {
+        close();
+    }
+
+    // starts writing to path, json if it ends in .json and csv otherwise; creates the queries
+    bool open(const std::string &path) {
+        close();
+        json = path.size() >= 5 && path.compare(path.size()-5, 5, ".json") == 0;
+        file.open(path);
+        if (!file) return false;
+        if (json) file << "[";
+        else file << "frame,start_ms,pass,gpu_ms\n";
+        slots.resize(latency);
+        for (Slot &s : slots) {
+            glGenQueries(1, &s.stamp);
+            s.passes.resize(maxPasses);
+            for (Pass &p : s.passes) glGenQueries(1, &p.query);
+        }
+        firstRow = true;
+        originSet = false;
+        return true;
+    }
+
+    // flushes what is still in flight (waiting is fine here) and closes the file
+    void close() {
+        if (!file.is_open()) return;
+        for (int i=0; i<latency; i++) {
+            current = (current+1) % latency;
+            collect(slots[current], true);
+        }
+        if (json) file << "\n]\n";
+        file.close();
+        for (Slot &s : slots) {
+            glDeleteQueries(1, &s.stamp);
+            for (Pass &p : s.passes) glDeleteQueries(1, &p.query);
+        }
+        slots.clear();
+    }
+
+    bool enabled() const {
+        return file.is_open();
+    }
+
+    void beginFrame(long long frame) {
+        if (!enabled()) return;
+        current = (current+1) % latency;
+        Slot &s = slots[current];
+        collect(s, false);
+        s.frame = frame;
+        s.used = 0;
+        s.pending = true;
+        glQueryCounter(s.stamp, GL_TIMESTAMP);
+    }
+
+    // passes may not overlap (GL_TIME_ELAPSED queries cannot nest); name must outlive the frame
+    void begin(const char *name) {
+        if (!enabled()) return;
+        Slot &s = slots[current];
+        if (!s.pending || s.used == maxPasses) return;
+        Pass &p = s.passes[s.used];
+        p.name = name;
+        glBeginQuery(GL_TIME_ELAPSED, p.query);
+        inPass = true;
+    }
+
+    void end() {
+        if (!enabled() || !inPass) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        slots[current].used++;
+        inPass = false;
+    }
+
+private:
+    struct Pass {
+        GLuint query = 0;
+        const char *name = "";
+    };
+
+    struct Slot {
+        GLuint stamp = 0;
+        std::vector<Pass> passes;
+        int used = 0;
+        long long frame = 0;
+        bool pending = false;
+    };
+
+    int latency;
+    int maxPasses;
+    std::vector<Slot> slots;
+    int current = 0;
+    bool inPass = false;
+    std::ofstream file;
+    bool json = false;
+    bool firstRow = true;
+    bool originSet = false;
+    GLuint64 origin = 0;
+
+    static bool available(GLuint query) {
+        GLuint ready = 0;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+        return ready;
+    }
+
+    void collect(Slot &s, bool wait) {
+        if (!s.pending) return;
+        s.pending = false;
+        if (!wait) {
+            // the end of the last pass is the last result to arrive
+            GLuint last = s.used > 0 ? s.passes[s.used-1].query : s.stamp;
+            if (!available(s.stamp) || !available(last)) return;
+        }
+        GLuint64 stamp = 0;
+        glGetQueryObjectui64v(s.stamp, GL_QUERY_RESULT, &stamp);
+        if (!originSet) {
+            origin = stamp;
+            originSet = true;
+        }
+        double start = double(stamp - origin)*1e-6;
+        if (json) {
+            file << (firstRow ? "\n" : ",\n") << "  {\"frame\": " << s.frame << ", \"start_ms\": " << start << ", \"passes\": {";
+            firstRow = false;
+        }
+        for (int i=0; i<s.used; i++) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(s.passes[i].query, GL_QUERY_RESULT, &ns);
+            double ms = double(ns)*1e-6;
+            if (json) file << (i ? ", " : "") << "\"" << s.passes[i].name << "\": " << ms;
+            else file << s.frame << "," << start << "," << s.passes[i].name << "," << ms << "\n";
+        }
+        if (json) file << "}}";
+    }
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include "glm/glm.hpp"
+#include "bigFixed.h"
+#include "scene.h"
+
+#include <vector>
+#include <cmath>
+
+/*
+Reference orbits for perturbation rendering.
+One point C (the reference) is iterated in high precision; every pixel c = C + dc then only iterates
+its small difference to that orbit, dz' = 2*Z*dz + dz^2 + dc, which fits in floats at any zoom.
+Zooms are carried as mantissa * 2^exponent (ScaledZoom in scene.h) since they go far below what a float
+or a double holds.
+*/
+
+struct ReferenceOrbit {
+    std::vector<glm::dvec2> z;  // Z_0 = 0 up to Z_maxIters, or the first Z that escaped
+    glm::dvec2 pos;             // the reference is pos + offset*2^offsetExp
+    glm::dvec2 offset;
+    int offsetExp;
+    int maxIters;
+    int limbs;
+};
+
+template<int N>
+void iterateOrbit(ReferenceOrbit &orbit) {
+    typedef BigFixed<N> F;
+    F cx = F::fromDouble(orbit.pos.x) + F::fromDouble(orbit.offset.x, orbit.offsetExp);
+    F cy = F::fromDouble(orbit.pos.y) + F::fromDouble(orbit.offset.y, orbit.offsetExp);
+    F zx, zy;
+    orbit.z.clear();
+    orbit.z.push_back(glm::dvec2(0.0));
+    for (int i=0; i<orbit.maxIters; i++) {
+        F x2 = zx*zx;
+        F y2 = zy*zy;
+        F xy = zx*zy;
+        zx = x2 - y2 + cx;
+        zy = xy + xy + cy;
+        glm::dvec2 z(zx.toDouble(), zy.toDouble());
+        orbit.z.push_back(z);
+        if (z.x*z.x + z.y*z.y > 4.0) break;
+    }
+}
+
+// limbs so that the fraction resolves 2^zoomExp with 64 bits to spare, at most 64 (zooms to ~1e-590)
+inline int orbitLimbs(int zoomExp) {
+    int bits = 64 - zoomExp;
+    int limbs = 4;
+    while (32*(limbs-1) < bits && limbs < 64) limbs *= 2;
+    return limbs;
+}
+
+// reference orbit at pos + offset*2^offsetExp, precise enough for pixels of size ~2^zoomExp
+inline ReferenceOrbit referenceOrbit(glm::dvec2 pos, glm::dvec2 offset, int offsetExp, int maxIters, int zoomExp) {
+    ReferenceOrbit orbit;
+    orbit.pos = pos;
+    orbit.offset = offset;
+    orbit.offsetExp = offsetExp;
+    orbit.maxIters = maxIters;
+    orbit.limbs = orbitLimbs(zoomExp);
+    switch (orbit.limbs) {
+        case 4: iterateOrbit<4>(orbit); break;
+        case 8: iterateOrbit<8>(orbit); break;
+        case 16: iterateOrbit<16>(orbit); break;
+        case 32: iterateOrbit<32>(orbit); break;
+        default: iterateOrbit<64>(orbit); break;
+    }
+    return orbit;
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef RENDER_TARGETS_H
+#define RENDER_TARGETS_H
+
+#include "glad/glad.h"
+
+#include <iostream>
+#include <algorithm>
+
+/*
+Every screen sized texture and renderbuffer of the cube passes, allocated together at the window size
+times ssaa and reallocated whenever that changes, plus the window sized buffer progressive refinement
+accumulates samples in.
+Frames may render into a smaller rectangle at the bottom left of the targets (the dynamic resolution
+of resolutionGovernor.h), so the size rendered at can change every frame without a reallocation.
+*/
+
+class RenderTargets {
+public:
+    GLuint fbo = 0, colorTex = 0, depthRBO = 0;
+    // iteration buffer of the recolour path, with its own depth buffer since resumed passes test against
+    // the depth of the pass they continue
+    GLuint itersFbo = 0, itersTex = 0, itersDepthRBO = 0;
+    // c of every count in itersTex, and copies of both from the frame before for temporal reprojection
+    GLuint cTex = 0, prevItersTex = 0, prevCTex = 0;
+    // z, iterations done and escaped/interior flag of every pixel, for resuming with a higher maxIters,
+    // and a copy from the frame before so reprojected pixels that were still bounded can go on
+    GLuint stateTex = 0, prevStateTex = 0;
+    // copy of the colour texture read by glitch passes, since they draw into colorTex
+    GLuint glitchTex = 0;
+    // iteration count of every pixel (-1 for none) for the edge test of adaptive supersampling
+    GLuint countTex = 0;
+    // visibility buffer: unit offset of c and face of every pixel, and the derivatives of the offset;
+    // shares depthRBO with fbo
+    GLuint visFbo = 0, visTex = 0, visDerivTex = 0;
+    // sum of the refinement samples of a still view, at window size
+    GLuint accumFbo = 0, accumTex = 0;
+    int width = 0, height = 0;
+    int screenWidth = 0, screenHeight = 0;
+
+    ~RenderTargets() {
+        release();
+    }
+
+    // reallocates everything if a size changed, returns true if it did (the contents are then undefined)
+    bool resize(int w, int h, int screenW, int screenH) {
+        w = std::max(w, 1);
+        h = std::max(h, 1);
+        screenW = std::max(screenW, 1);
+        screenH = std::max(screenH, 1);
+        if (w == width && h == height && screenW == screenWidth && screenH == screenHeight) return false;
+        release();
+        width = w;
+        height = h;
+        screenWidth = screenW;
+        screenHeight = screenH;
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        colorTex = texture(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_LINEAR);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+        depthRBO = depthBuffer();
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "FBO not complete.\n";
+        }
+
+        glGenFramebuffers(1, &visFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, visFbo);
+        visTex = texture(GL_RGBA32F, GL_RGBA, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, visTex, 0);
+        visDerivTex = texture(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, visDerivTex, 0);
+        GLenum visBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, visBuffers);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Visibility FBO not complete.\n";
+        }
+
+        glGenFramebuffers(1, &itersFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, itersFbo);
+        itersTex = texture(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, itersTex, 0);
+        cTex = texture(GL_RG32F, GL_RG, GL_FLOAT, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, cTex, 0);
+        GLenum buffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, buffers);
+        itersDepthRBO = depthBuffer();
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Iteration FBO not complete.\n";
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenTextures(1, &stateTex);
+        glBindTexture(GL_TEXTURE_2D, stateTex);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+        glGenTextures(1, &prevStateTex);
+        glBindTexture(GL_TEXTURE_2D, prevStateTex);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glitchTex = texture(GL_RGBA16F, GL_RGBA, GL_FLOAT, GL_NEAREST);
+        countTex = texture(GL_R32I, GL_RED_INTEGER, GL_INT, GL_NEAREST);
+        prevItersTex = texture(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, GL_NEAREST);
+        prevCTex = texture(GL_RG32F, GL_RG, GL_FLOAT, GL_NEAREST);
+
+        glGenFramebuffers(1, &accumFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, accumFbo);
+        accumTex = texture(GL_RGBA32F, GL_RGBA, GL_FLOAT, GL_NEAREST, screenWidth, screenHeight);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Accumulation FBO not complete.\n";
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+    void release() {
+        if (width == 0) return;
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteFramebuffers(1, &itersFbo);
+        glDeleteFramebuffers(1, &accumFbo);
+        glDeleteFramebuffers(1, &visFbo);
+        glDeleteRenderbuffers(1, &depthRBO);
+        glDeleteRenderbuffers(1, &itersDepthRBO);
+        GLuint textures[] = {colorTex, itersTex, stateTex, prevStateTex, glitchTex, accumTex, cTex, prevItersTex, prevCTex, visTex, visDerivTex, countTex};
+        glDeleteTextures(12, textures);
+        width = height = 0;
+        screenWidth = screenHeight = 0;
+    }
+
+private:
+    // render target sized texture unless given another size
+    GLuint texture(GLenum internalFormat, GLenum format, GLenum type, GLint filter, int w = 0, int h = 0) const {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w ? w : width, h ? h : height, 0, format, type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return tex;
+    }
+
+    // attached to the bound framebuffer
+    GLuint depthBuffer() const {
+        GLuint rbo;
+        glGenRenderbuffers(1, &rbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
+        return rbo;
+    }
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef RESOLUTION_GOVERNOR_H
+#define RESOLUTION_GOVERNOR_H
+
+#include "glad/glad.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+/*
+Dynamic resolution: picks the fraction of the render targets (renderTargets.h) each frame renders at
+so that the GPU time of a frame stays under a budget.
+The GPU time of a frame comes from two GL_TIMESTAMP queries, which unlike GL_TIME_ELAPSED can be
+issued while GpuTimer has a pass open. As in GpuTimer they go into a ring and are read some frames
+later, and a frame whose results are not in yet is skipped rather than waited for.
+Cost goes with the number of pixels, so an over budget frame moves the scale straight to
+scale*sqrt(budget/time); the scale only creeps back up one step at a time after a run of frames well
+under budget, which keeps it from flipping between two sizes. With ssaa above 1 the targets are
+already supersampled and a lower scale first takes away supersampling before native resolution.
+*/
+
+class ResolutionGovernor {
+public:
+    float budgetMs;
+    float minScale;
+    float scale = 1.0f;     // fraction of the target width and height rendered this frame
+
+    ResolutionGovernor(float budgetMs = 14.0f, float minScale = 0.5f, int latency = 4) :
+        budgetMs(budgetMs), minScale(minScale), latency(latency)
+    {
+    }
+
+    ~ResolutionGovernor() {
+        release();
+    }
+
+    void beginFrame() {
+        if (slots.empty()) {
+            slots.resize(latency);
+            for (Slot &s : slots) glGenQueries(2, s.stamps);
+        }
+        current = (current+1) % latency;
+        Slot &s = slots[current];
+        collect(s);
+        s.scale = scale;
+        s.pending = true;
+        glQueryCounter(s.stamps[0], GL_TIMESTAMP);
+    }
+
+    // only measured frames feed the governor, not ones that just recoloured a cached iteration buffer
+    void endFrame(bool measured) {
+        if (slots.empty()) return;
+        slots[current].measured = measured;
+        glQueryCounter(slots[current].stamps[1], GL_TIMESTAMP);
+    }
+
+    // pixels rendered along a side of the targets that is size long
+    int scaled(int size) const {
+        return std::max(1, (int)std::lround(size*scale));
+    }
+
+    void release() {
+        for (Slot &s : slots) glDeleteQueries(2, s.stamps);
+        slots.clear();
+    }
+
+private:
+    static constexpr float step = 0.125f;
+    // frames in a row under this share of the budget before the scale goes up a step
+    static constexpr float headroom = 0.6f;
+    static constexpr int calmFrames = 30;
+
+    struct Slot {
+        GLuint stamps[2] = {0, 0};
+        bool measured = false;
+        bool pending = false;
+        float scale = 1.0f;
+    };
+
+    int latency;
+    std::vector<Slot> slots;
+    int current = 0;
+    int calm = 0;
+    float smoothMs = -1.0f;
+
+    void collect(Slot &s) {
+        if (!s.pending) return;
+        s.pending = false;
+        // frames from before the last change say nothing about the current scale
+        if (!s.measured || s.scale != scale) return;
+        GLuint ready = 0;
+        glGetQueryObjectuiv(s.stamps[1], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) return;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(s.stamps[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(s.stamps[1], GL_QUERY_RESULT, &end);
+        update(float(double(end - begin)*1e-6));
+    }
+
+    void update(float ms) {
+        // light smoothing so a single slow frame (a new reference orbit, a glitch pass) does not count
+        smoothMs = smoothMs < 0.0f ? ms : 0.7f*smoothMs + 0.3f*ms;
+        float next = scale;
+        if (smoothMs > budgetMs) {
+            calm = 0;
+            next = std::floor(scale*std::sqrt(budgetMs/smoothMs)/step)*step;
+            next = std::min(next, scale - step);
+        }
+        else if (smoothMs < budgetMs*headroom && ++calm >= calmFrames) {
+            calm = 0;
+            next = scale + step;
+        }
+        next = std::clamp(next, minScale, 1.0f);
+        if (next != scale) {
+            scale = next;
+            smoothMs = -1.0f;
+        }
+    }
+};
+
+#endif
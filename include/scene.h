@@ -0,0 +1,192 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "camera.h"
+
+#include <vector>
+#include <cmath>
+
+/*
+Scene description shared by the OpenGL renderer (main.cpp) and the CPU renderer (headless.cpp).
+Everything the cube pass needs for one frame is gathered into a Frame so both renderers see
+exactly the same uniforms.
+*/
+
+struct Shot {
+    glm::vec2 pos1;
+    glm::vec2 pos2;
+    float zoom1;
+    float zoom2;
+    float t;
+};
+
+// zoomVal^scrollVal as mantissa in [1, 2) times 2^exponent, exact far past where a double underflows
+struct ScaledZoom {
+    double mantissa;
+    int exponent;
+};
+
+inline ScaledZoom scaledZoom(double zoomVal, double scrollVal) {
+    double l = scrollVal*std::log2(zoomVal);
+    int e = (int)std::floor(l);
+    return {std::exp2(l - e), e};
+}
+
+// uniforms of the cube pass (vShader32.glsl/fShader32.glsl)
+struct Frame {
+    glm::mat4 mat;
+    glm::mat4 effectMat;
+    double zoom;
+    ScaledZoom scaled;  // zoom again, for the deep zoom renderers
+    glm::dvec2 pos;
+    int maxIters;
+    glm::vec3 c1;
+    glm::vec3 c2;
+    int banding;
+};
+
+inline float cube[] = {
+    // Position           // Texture   // Normal
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,  0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  0.0f, -1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  0.0f, 1.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,  0.0f,  0.0f, 1.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,  0.0f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -1.0f,  0.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, -1.0f,  0.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -1.0f,  0.0f,  0.0f,
+
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  1.0f,  0.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  1.0f,  0.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  1.0f,  0.0f,  0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f, -1.0f,  0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f, -1.0f,  0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  0.0f, -1.0f,  0.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  1.0f,  0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  1.0f,  0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  1.0f,  0.0f,
+};
+
+// c on a face of cube[] is affine in the face's texture coordinates: c = origin + u*du + v*dv
+struct FacePlane {
+    glm::dvec2 origin;
+    glm::dvec2 du;
+    glm::dvec2 dv;
+
+    bool operator==(const FacePlane &other) const = default;
+};
+
+// corners of face 0-5 of cube[] at texture coordinates (0, 0), (1, 0) and (0, 1), and its outward normal
+inline void faceCorners(int face, glm::vec3 &p00, glm::vec3 &p10, glm::vec3 &p01, glm::vec3 &normal) {
+    for (int v=0; v<6; v++) {
+        const float *a = &cube[(face*6 + v)*8];
+        glm::vec3 p(a[0], a[1], a[2]);
+        if (a[3] == 0.0f && a[4] == 0.0f) p00 = p;
+        else if (a[3] == 1.0f && a[4] == 0.0f) p10 = p;
+        else if (a[3] == 0.0f && a[4] == 1.0f) p01 = p;
+        normal = glm::vec3(a[5], a[6], a[7]);
+    }
+}
+
+// the mapping vShader32.glsl applies to the points of a face (c = pos + zoom*(effectMat*aPos).xy)
+inline FacePlane facePlane(int face, const glm::mat4 &effectMat, double zoom, glm::dvec2 pos) {
+    glm::vec3 p00, p10, p01, normal;
+    faceCorners(face, p00, p10, p01, normal);
+    glm::dvec2 c00 = glm::dvec2(effectMat*glm::vec4(p00, 1.0f));
+    glm::dvec2 c10 = glm::dvec2(effectMat*glm::vec4(p10, 1.0f));
+    glm::dvec2 c01 = glm::dvec2(effectMat*glm::vec4(p01, 1.0f));
+    return {pos + zoom*c00, zoom*(c10 - c00), zoom*(c01 - c00)};
+}
+
+inline std::vector<Shot> defaultShots() {
+    return {
+        {{-1.4013f, 0.00041294f}, {-1.4013f, 0.00041294f}, -12.0f, -65.0f, 30.0f},
+        {{-1.35653, 0.0685965}, {-1.36048, 0.0710716}, -29.0f, -29.0f, 40.0f}
+    };
+}
+
+inline glm::vec2 lerpVec2(glm::vec2 v1, glm::vec2 v2, float t) {
+    glm::vec2 r;
+
+    r.x = v1.x + t*(v2.x-v1.x);
+    r.y = v1.y + t*(v2.y-v1.y);
+
+    return r;
+}
+
+inline float lerpFloat(float a, float b, float t) {
+    float r;
+
+    r = a + t*(b-a);
+
+    return r;
+}
+
+// projection * view * model for the spinning cube, as uploaded to "mat"
+inline glm::mat4 cubeMatrix(const Camera &camera, float t, bool explorationMode, int scrX, int scrY) {
+    float angle = 0.0f;
+    glm::mat4 view = glm::mat4(1.0f);
+    view = glm::lookAt(camera.Pos, camera.Pos + camera.Front, camera.Up);
+    glm::mat4 projection;
+    projection = glm::perspective(glm::radians(camera.FOV), (float)scrX/(float)scrY, 0.1f, 100.0f);
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.0f));
+    if (!explorationMode) angle = glm::radians(17.4538f*t);
+    model = glm::rotate(model, angle, glm::vec3(0.9f, 0.6f, 0.1f));
+    return projection * view * model;
+}
+
+// rotation of the mandelbrot plane inside the cube, as uploaded to "effectMat"
+inline glm::mat4 effectMatrix(float t, bool explorationMode) {
+    float angle = 0.0f;
+    glm::mat4 effect = glm::mat4(1.0f);
+    if (!explorationMode) angle = glm::radians(10.123f*t);
+    effect = glm::rotate(effect, angle, glm::vec3(1.0f, 0.3f, 0.5f));
+    return effect;
+}
+
+// position and zoom level of the timeline at time t (looping over all shots), returns the shot playing
+// or -1 if there is none
+inline int sampleShots(const std::vector<Shot> &shots, float t, glm::dvec2 &pos, double &scrollVal) {
+    float total = 0.0f;
+    for (const Shot &s : shots) total += s.t;
+    if (shots.empty() || total <= 0.0f) return -1;
+    float local = std::fmod(t, total);
+    for (size_t i=0; i<shots.size(); i++) {
+        const Shot &s = shots[i];
+        if (local <= s.t) {
+            pos = lerpVec2(s.pos1, s.pos2, local / s.t);
+            scrollVal = lerpFloat(s.zoom1, s.zoom2, local / s.t);
+            return (int)i;
+        }
+        local -= s.t;
+    }
+    return -1;
+}
+
+#endif
@@ -84,6 +84,47 @@ public:
         glDeleteShader(fragment);
     }
 
+    // compute shader program
+    explicit Shader(const char* computePath) {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+        }
+        catch(const std::ifstream::failure &)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        }
+        const char* cShaderCode = computeCode.c_str();
+
+        unsigned int compute;
+        int  success;
+        char infoLog[512];
+        compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(compute, 512, NULL, infoLog);
+            std::cout << "Error: compilation of " << computePath << " failed.\n" << infoLog << "\n";
+        }
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if(!success) {
+            glGetProgramInfoLog(ID, 512, NULL, infoLog);
+            std::cout << "Error: Shader program compillation failed.\n" << infoLog << "\n";
+        }
+        glDeleteShader(compute);
+    }
+
     void use() {
         glUseProgram(ID);
     }
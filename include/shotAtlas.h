@@ -0,0 +1,125 @@
+#ifndef SHOT_ATLAS_H
+#define SHOT_ATLAS_H
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "scene.h"
+#include "zoomLevels.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+/*
+Shot atlas: every shot gets the pyramid of zoom levels of zoomLevels.h (one per power of two of zoom,
+covering every c the shot shows), and playback then only samples them instead of iterating.
+Levels are computed in double precision (escapeItersD) on background threads, in the order a shot
+plays them and starting with the shot that is playing, and uploaded as R32UI textures by the render
+thread as they finish, which frees their counts in RAM. Levels too deep for doubles are left out and
+those frames render as usual.
+*/
+
+struct AtlasLevel : ZoomLevel {
+    std::atomic<bool> done{false};
+    GLuint tex = 0;
+};
+
+class ShotAtlas {
+public:
+    int maxIters = -1;
+    double density = 384.0;
+    int maxSize = 4096;
+    // deepest level computed, doubles lose the detail below it
+    double minZoom = 1e-12;
+
+    ~ShotAtlas() {
+        release();
+    }
+
+    // plans the pyramids of every shot and starts computing them from shot first on, with threads workers
+    void start(const std::vector<Shot> &shots, double zoomVal, int iters, int first, int threads) {
+        stop();
+        releaseTextures();
+        maxIters = iters;
+        pyramids.clear();
+        for (const Shot &s : shots) pyramids.push_back(planZoomLevels<AtlasLevel>(s, zoomVal, density, maxSize, minZoom));
+        stopping = false;
+        int n = (int)pyramids.size();
+        worker = std::thread([this, n, first, threads, iters]() {
+            TileScheduler scheduler(threads);
+            for (int k=0; k<n && !stopping; k++) {
+                for (auto &level : pyramids[(first + k) % n]) {
+                    if (stopping) break;
+                    if (computeZoomLevel(*level, scheduler, iters, stopping)) level->done.store(true, std::memory_order_release);
+                }
+            }
+        });
+    }
+
+    // level of a shot for zoom if it is ready, uploading it on first use; nullptr if it is not
+    const AtlasLevel *level(int shot, double zoom) {
+        if (shot < 0 || shot >= (int)pyramids.size()) return nullptr;
+        int exponent = zoomExponent(zoom);
+        for (auto &level : pyramids[shot]) {
+            if (level->exponent != exponent) continue;
+            if (!level->done.load(std::memory_order_acquire)) return nullptr;
+            if (level->tex == 0) upload(*level);
+            return level.get();
+        }
+        return nullptr;
+    }
+
+    // uploads one finished level that has no texture yet, so the counts of finished levels do not pile up in
+    // RAM until their shot plays; called by the render thread once a frame
+    void uploadFinished() {
+        for (auto &pyramid : pyramids) {
+            for (auto &level : pyramid) {
+                if (level->tex != 0 || !level->done.load(std::memory_order_acquire)) continue;
+                upload(*level);
+                return;
+            }
+        }
+    }
+
+    void stop() {
+        stopping = true;
+        if (worker.joinable()) worker.join();
+    }
+
+    void release() {
+        stop();
+        releaseTextures();
+        pyramids.clear();
+    }
+
+private:
+    std::vector<std::vector<std::unique_ptr<AtlasLevel>>> pyramids;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    void upload(AtlasLevel &level) {
+        glGenTextures(1, &level.tex);
+        glBindTexture(GL_TEXTURE_2D, level.tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, level.size.x, level.size.y, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, level.iters.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // the texture is the only copy from here on
+        std::vector<uint32_t>().swap(level.iters);
+    }
+
+    void releaseTextures() {
+        for (auto &pyramid : pyramids) {
+            for (auto &level : pyramid) {
+                if (level->tex != 0) glDeleteTextures(1, &level->tex);
+                level->tex = 0;
+            }
+        }
+    }
+};
+
+#endif
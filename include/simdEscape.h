@@ -0,0 +1,173 @@
+#ifndef SIMD_ESCAPE_H
+#define SIMD_ESCAPE_H
+
+#include "escape.h"
+
+#include <cstring>
+#include <string>
+
+/*
+Vectorized escape-time loop for the CPU renderer. Iterates 4 (SSE), 8 (AVX2) or 16 (AVX-512)
+pixels at once and picks the widest instruction set the CPU supports at runtime.
+Lanes are refilled as soon as their pixel escapes (or reaches maxIters, or is caught in a cycle), so
+one slow pixel does not hold up the rest of the batch. Results are identical to escapeIters.
+*/
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+typedef void (*EscapeBatchFn)(const float *cx, const float *cy, int *iters, int count, int maxIters);
+
+template<int N>
+struct Lanes {
+    typedef float vf __attribute__((vector_size(N*sizeof(float))));
+    typedef int vi __attribute__((vector_size(N*sizeof(int))));
+};
+
+template<int N>
+[[gnu::always_inline]] inline bool anyLane(const typename Lanes<N>::vi &v) {
+    long long w[N/2];
+    memcpy(w, &v, sizeof(v));
+    long long r = 0;
+    for (int k=0; k<N/2; k++) r |= w[k];
+    return r != 0;
+}
+
+// always inlined into the target specific wrappers below so the vector code is compiled for their ISA
+template<int N>
+[[gnu::always_inline]] inline void escapeLanes(const float *cx, const float *cy, int *iters, int count, int maxIters) {
+    typedef typename Lanes<N>::vf vf;
+    typedef typename Lanes<N>::vi vi;
+    if (maxIters <= 0) {
+        for (int p=0; p<count; p++) iters[p] = 0;
+        return;
+    }
+    vf zx = {}, zy = {}, vcx = {}, vcy = {};
+    vf savedX = {}, savedY = {};
+    vi it = {}, period = {}, limit = {};
+    const vf four = vf{} + 4.0f;
+    const vi last = vi{} + (maxIters-1);
+    int pixel[N];
+    int next = 0;
+    int active = 0;
+    // puts the next pixel that is not in the cardioid or bulb into lane k
+    auto load = [&](int k) __attribute__((always_inline)) {
+        while (next < count && inCardioidOrBulb(cx[next], cy[next])) {
+            iters[next++] = maxIters-1;
+        }
+        zx[k] = 0.0f;
+        zy[k] = 0.0f;
+        savedX[k] = 0.0f;
+        savedY[k] = 0.0f;
+        period[k] = 0;
+        limit[k] = periodStart;
+        if (next < count) {
+            vcx[k] = cx[next];
+            vcy[k] = cy[next];
+            pixel[k] = next++;
+            active++;
+        }
+        else {
+            vcx[k] = 0.0f;
+            vcy[k] = 0.0f;
+            pixel[k] = -1;
+        }
+    };
+    for (int k=0; k<N; k++) load(k);
+    while (active > 0) {
+        vf x = zx*zx - zy*zy + vcx;
+        vf y = 2.0f*zx*zy + vcy;
+        zx = x;
+        zy = y;
+        // lane masks from sign bits rather than vector compares, which gcc splits into scalar
+        // compares for 16 lanes: a < b exactly when a - b is negative (c is never NaN)
+        vi escaped = (vi)(four - (x*x + y*y)) >> 31;
+        vi diff = ((vi)(x - savedX) | (vi)(y - savedY)) & 0x7fffffff;
+        vi cycle = (diff - 1) >> 31;
+        vi done = escaped | cycle | ((last - it - 1) >> 31);
+        if (anyLane<N>(done)) {
+            for (int k=0; k<N; k++) {
+                if (!done[k]) continue;
+                if (pixel[k] >= 0) {
+                    // last iteration that did not escape, like the shader
+                    if (escaped[k]) iters[pixel[k]] = it[k] > 0 ? it[k]-1 : 0;
+                    else iters[pixel[k]] = maxIters-1;
+                    active--;
+                }
+                it[k] = -1;
+                load(k);
+            }
+        }
+        // Brent: move the saved point forward every time the period limit is reached
+        period += 1;
+        vi save = period == limit;
+        savedX = save ? zx : savedX;
+        savedY = save ? zy : savedY;
+        limit = save ? limit*2 : limit;
+        period = save ? 0 : period;
+        it += 1;
+    }
+}
+
+inline void escapeBatchScalar(const float *cx, const float *cy, int *iters, int count, int maxIters) {
+    for (int p=0; p<count; p++) iters[p] = escapeIters(cx[p], cy[p], maxIters);
+}
+
+inline void escapeBatchSSE(const float *cx, const float *cy, int *iters, int count, int maxIters) {
+    escapeLanes<4>(cx, cy, iters, count, maxIters);
+}
+
+__attribute__((target("avx2")))
+inline void escapeBatchAVX2(const float *cx, const float *cy, int *iters, int count, int maxIters) {
+    escapeLanes<8>(cx, cy, iters, count, maxIters);
+}
+
+// AVX-512 implies FMA, keep mul and add separate so the results match the other kernels
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+inline void escapeBatchAVX512(const float *cx, const float *cy, int *iters, int count, int maxIters) {
+    escapeLanes<16>(cx, cy, iters, count, maxIters);
+}
+
+// widest instruction set reported by cpuid (and enabled by the OS)
+inline SimdLevel detectSimd() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE;
+    return SIMD_SCALAR;
+}
+
+inline EscapeBatchFn escapeBatchFor(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX512: return escapeBatchAVX512;
+        case SIMD_AVX2: return escapeBatchAVX2;
+        case SIMD_SSE: return escapeBatchSSE;
+        default: return escapeBatchScalar;
+    }
+}
+
+inline const char *simdName(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX512: return "avx512";
+        case SIMD_AVX2: return "avx2";
+        case SIMD_SSE: return "sse";
+        default: return "scalar";
+    }
+}
+
+// parses a name printed by simdName, returns false if unknown
+inline bool parseSimd(const std::string &name, SimdLevel &level) {
+    for (int l=SIMD_SCALAR; l<=SIMD_AVX512; l++) {
+        if (name == simdName((SimdLevel)l)) {
+            level = (SimdLevel)l;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef SOLID_GUESS_H
+#define SOLID_GUESS_H
+
+#include "simdEscape.h"
+
+#include <vector>
+
+/*
+Mariani-Silver solid guessing for one tile of the CPU renderer.
+Only the border of a rectangle is iterated; if every border pixel lies on the same cube face and has
+the same iteration count the inside is filled with that count, otherwise the rectangle is split in
+four and each quarter is tried again. Relies on the bands of the mandelbrot set being connected, so
+it can miss features thinner than the rectangle: off by default, exact renders should leave it off.
+*/
+
+// per pixel state of the tile being guessed
+struct GuessTile {
+    int width = 0;
+    int height = 0;
+    std::vector<int> face;      // cube face covering the pixel, -1 if none
+    std::vector<float> cx, cy;
+    std::vector<int> iters;     // unknownIters until computed or guessed
+    int guessed = 0;
+
+    static constexpr int unknownIters = -2;
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        face.assign(size_t(w)*h, -1);
+        cx.assign(size_t(w)*h, 0.0f);
+        cy.assign(size_t(w)*h, 0.0f);
+        iters.assign(size_t(w)*h, unknownIters);
+        guessed = 0;
+    }
+};
+
+class SolidGuess {
+public:
+    EscapeBatchFn escape;
+    int maxIters;
+    int minSize;    // rectangles this small are computed in full instead of split again
+
+    SolidGuess(EscapeBatchFn escape, int maxIters, int minSize = 4) : escape(escape), maxIters(maxIters), minSize(minSize)
+    {
+    }
+
+    // rectangles are handled a whole subdivision level at a time so the escape kernel gets large
+    // batches to keep its lanes busy
+    void run(GuessTile &g) {
+        if (g.width == 0 || g.height == 0) return;
+        std::vector<Rect> rects = {{0, 0, g.width-1, g.height-1}};
+        std::vector<Rect> next;
+        while (!rects.empty()) {
+            index.clear();
+            for (const Rect &r : rects) addBorder(g, r);
+            compute(g);
+            index.clear();
+            next.clear();
+            for (const Rect &r : rects) {
+                if (r.x1-r.x0 < 2 || r.y1-r.y0 < 2) continue;
+                if (fillSolid(g, r)) continue;
+                if (r.x1-r.x0 <= minSize || r.y1-r.y0 <= minSize) {
+                    for (int y=r.y0+1; y<r.y1; y++) {
+                        for (int x=r.x0+1; x<r.x1; x++) index.push_back(y*g.width + x);
+                    }
+                    continue;
+                }
+                int mx = (r.x0+r.x1)/2;
+                int my = (r.y0+r.y1)/2;
+                next.push_back({r.x0, r.y0, mx, my});
+                next.push_back({mx, r.y0, r.x1, my});
+                next.push_back({r.x0, my, mx, r.y1});
+                next.push_back({mx, my, r.x1, r.y1});
+            }
+            compute(g);
+            rects.swap(next);
+        }
+    }
+
+private:
+    struct Rect {
+        int x0, y0;
+        int x1, y1;     // inclusive
+    };
+
+    std::vector<float> cx, cy;
+    std::vector<int> index, todo, result;
+
+    // iterates every listed pixel that is not known yet in one batch
+    void compute(GuessTile &g) {
+        cx.clear();
+        cy.clear();
+        todo.clear();
+        for (int p : index) {
+            if (g.iters[p] != GuessTile::unknownIters) continue;
+            if (g.face[p] < 0) {
+                g.iters[p] = -1;
+                continue;
+            }
+            g.iters[p] = -3;    // marks p as queued when it is listed twice
+            cx.push_back(g.cx[p]);
+            cy.push_back(g.cy[p]);
+            todo.push_back(p);
+        }
+        result.resize(todo.size());
+        escape(cx.data(), cy.data(), result.data(), (int)todo.size(), maxIters);
+        for (size_t i=0; i<todo.size(); i++) g.iters[todo[i]] = result[i];
+    }
+
+    void addBorder(const GuessTile &g, const Rect &r) {
+        for (int x=r.x0; x<=r.x1; x++) {
+            index.push_back(r.y0*g.width + x);
+            index.push_back(r.y1*g.width + x);
+        }
+        for (int y=r.y0+1; y<r.y1; y++) {
+            index.push_back(y*g.width + r.x0);
+            index.push_back(y*g.width + r.x1);
+        }
+    }
+
+    // fills the inside of r if its border is one face and one iteration count; pixels of other
+    // faces poking into r are queued in index to be computed normally
+    bool fillSolid(GuessTile &g, const Rect &r) {
+        int face = g.face[r.y0*g.width + r.x0];
+        int iters = g.iters[r.y0*g.width + r.x0];
+        if (face < 0) return false;
+        for (int x=r.x0; x<=r.x1; x++) {
+            for (int y : {r.y0, r.y1}) {
+                int p = y*g.width + x;
+                if (g.face[p] != face || g.iters[p] != iters) return false;
+            }
+        }
+        for (int y=r.y0+1; y<r.y1; y++) {
+            for (int x : {r.x0, r.x1}) {
+                int p = y*g.width + x;
+                if (g.face[p] != face || g.iters[p] != iters) return false;
+            }
+        }
+        for (int y=r.y0+1; y<r.y1; y++) {
+            for (int x=r.x0+1; x<r.x1; x++) {
+                int p = y*g.width + x;
+                if (g.iters[p] != GuessTile::unknownIters) continue;
+                if (g.face[p] == face) {
+                    g.iters[p] = iters;
+                    g.guessed++;
+                }
+                else index.push_back(p);
+            }
+        }
+        return true;
+    }
+};
+
+#endif
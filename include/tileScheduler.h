@@ -0,0 +1,221 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+Splits a frame into tiles and runs them on a pool of workers.
+Tiles are ordered along a Hilbert or Morton curve so neighbouring tiles (similar c, similar cost)
+stay on the same worker. Each worker gets a contiguous run of the curve in its own deque, takes tiles
+from the front and, once empty, steals from the back of the other deques, so a worker stuck on the
+set boundary does not leave the rest idle.
+*/
+
+struct Tile {
+    int x0, y0;
+    int x1, y1;     // exclusive
+};
+
+enum TileOrder {
+    ORDER_ROWS,
+    ORDER_MORTON,
+    ORDER_HILBERT
+};
+
+// position d along a Hilbert curve filling an n x n grid (n a power of two)
+inline void hilbertPoint(int n, int d, int &x, int &y) {
+    x = 0;
+    y = 0;
+    for (int s=1; s<n; s*=2) {
+        int rx = 1 & (d/2);
+        int ry = 1 & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s-1 - x;
+                y = s-1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s*rx;
+        y += s*ry;
+        d /= 4;
+    }
+}
+
+inline void mortonPoint(int d, int &x, int &y) {
+    x = 0;
+    y = 0;
+    for (int bit=0; bit<16; bit++) {
+        x |= ((d >> (2*bit)) & 1) << bit;
+        y |= ((d >> (2*bit+1)) & 1) << bit;
+    }
+}
+
+inline std::vector<Tile> makeTiles(int width, int height, int tileSize, TileOrder order) {
+    int tilesX = (width + tileSize-1)/tileSize;
+    int tilesY = (height + tileSize-1)/tileSize;
+    std::vector<Tile> tiles;
+    auto add = [&](int tx, int ty) {
+        if (tx >= tilesX || ty >= tilesY) return;
+        tiles.push_back({tx*tileSize, ty*tileSize, std::min((tx+1)*tileSize, width), std::min((ty+1)*tileSize, height)});
+    };
+    if (order == ORDER_ROWS) {
+        for (int ty=0; ty<tilesY; ty++) {
+            for (int tx=0; tx<tilesX; tx++) add(tx, ty);
+        }
+        return tiles;
+    }
+    // walk the curve over the enclosing power of two grid and skip points outside the frame
+    int n = 1;
+    while (n < tilesX || n < tilesY) n *= 2;
+    for (int d=0; d<n*n; d++) {
+        int tx, ty;
+        if (order == ORDER_HILBERT) hilbertPoint(n, d, tx, ty);
+        else mortonPoint(d, tx, ty);
+        add(tx, ty);
+    }
+    return tiles;
+}
+
+inline const char *orderName(TileOrder order) {
+    switch (order) {
+        case ORDER_HILBERT: return "hilbert";
+        case ORDER_MORTON: return "morton";
+        default: return "rows";
+    }
+}
+
+inline bool parseOrder(const std::string &name, TileOrder &order) {
+    for (int o=ORDER_ROWS; o<=ORDER_HILBERT; o++) {
+        if (name == orderName((TileOrder)o)) {
+            order = (TileOrder)o;
+            return true;
+        }
+    }
+    return false;
+}
+
+// cpus a list can name, the size of the affinity mask
+#ifdef __linux__
+const long maxCpus = CPU_SETSIZE;
+#else
+const long maxCpus = 1024;
+#endif
+
+// parses a cpu list like "0-3,8,10-11", returns false on bad input (inverted ranges, cpus past maxCpus)
+inline bool parseCpuList(const std::string &list, std::vector<int> &cpus) {
+    cpus.clear();
+    size_t i = 0;
+    while (i < list.size()) {
+        char *end;
+        long lo = strtol(list.c_str()+i, &end, 10);
+        if (end == list.c_str()+i || lo < 0) return false;
+        long hi = lo;
+        i = end - list.c_str();
+        if (i < list.size() && list[i] == '-') {
+            hi = strtol(list.c_str()+i+1, &end, 10);
+            if (end == list.c_str()+i+1 || hi < lo) return false;
+            i = end - list.c_str();
+        }
+        if (hi >= maxCpus) return false;
+        for (long c=lo; c<=hi; c++) cpus.push_back((int)c);
+        if (i < list.size()) {
+            if (list[i] != ',') return false;
+            i++;
+        }
+    }
+    return !cpus.empty();
+}
+
+class TileScheduler {
+public:
+    int threads;
+    std::vector<int> cpus;      // worker i runs on cpus[i % cpus.size()], empty leaves placement to the OS
+
+    TileScheduler(int threads = 0) : threads(threads)
+    {
+        if (this->threads <= 0) this->threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // calls work(tile, worker) once for every tile, returns when all are done
+    void run(const std::vector<Tile> &tiles, const std::function<void(const Tile&, int)> &work) {
+        int n = std::max(1, std::min(threads, (int)tiles.size()));
+        std::vector<Queue> queues(n);
+        // contiguous runs of the curve so each worker starts on a compact region
+        for (size_t i=0; i<tiles.size(); i++) {
+            queues[i*n/tiles.size()].tiles.push_back(tiles[i]);
+        }
+#ifdef __linux__
+        // worker 0 is the calling thread, it gets its original placement back afterwards
+        cpu_set_t original;
+        pthread_getaffinity_np(pthread_self(), sizeof(original), &original);
+#endif
+        auto worker = [&](int id) {
+            pin(id);
+            Tile tile;
+            while (pop(queues[id], tile) || steal(queues, id, tile)) {
+                work(tile, id);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int i=1; i<n; i++) pool.emplace_back(worker, i);
+        worker(0);
+        for (std::thread &th : pool) th.join();
+#ifdef __linux__
+        if (!cpus.empty()) pthread_setaffinity_np(pthread_self(), sizeof(original), &original);
+#endif
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Tile> tiles;
+    };
+
+    static bool pop(Queue &q, Tile &tile) {
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tiles.empty()) return false;
+        tile = q.tiles.front();
+        q.tiles.pop_front();
+        return true;
+    }
+
+    // takes the far end of another worker's run, away from where its owner is working
+    static bool steal(std::vector<Queue> &queues, int id, Tile &tile) {
+        int n = (int)queues.size();
+        for (int k=1; k<n; k++) {
+            Queue &q = queues[(id+k) % n];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tiles.empty()) continue;
+            tile = q.tiles.back();
+            q.tiles.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void pin(int id) {
+#ifdef __linux__
+        if (cpus.empty()) return;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[id % cpus.size()], &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)id;
+#endif
+    }
+};
+
+#endif
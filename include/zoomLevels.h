@@ -0,0 +1,123 @@
+#ifndef ZOOM_LEVELS_H
+#define ZOOM_LEVELS_H
+
+#include "glm/glm.hpp"
+#include "scene.h"
+#include "escape.h"
+#include "tileScheduler.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+/*
+Zoom levels of a shot: a shot's pos and zoom are known for its whole length before it plays, so the
+iteration counts of every c it will show can be computed ahead of time and frames only resample them.
+There is one level per power of two of zoom. Level L holds the c the cube shows while zoom is in
+[2^L, 2^(L+1)), on a grid of density texels per unit of (c - pos)/zoom at zoom 2^L.
+Points of the cube are at most sqrt(3)/2 from its centre and effectMat only rotates them, so c is
+always within 0.87*zoom of pos.
+Used by the shot atlas of the windowed program (shotAtlas.h) and the keyframe mode of the headless
+renderer.
+*/
+
+struct ZoomLevel {
+    int exponent;               // zoom in [2^exponent, 2^(exponent+1))
+    float firstSeen;            // progress through the shot where the level is first shown
+    glm::dvec2 origin;          // c at the bottom left corner of the grid
+    glm::dvec2 extent;          // c covered along x and y
+    glm::ivec2 size;            // texels
+    std::vector<uint32_t> iters;
+};
+
+// level whose zoom range holds zoom
+inline int zoomExponent(double zoom) {
+    return (int)std::floor(std::log2(zoom));
+}
+
+// the levels of a shot in the order it shows them, from pos and zoom along the shot as sampleShots
+// plays it; zooms below minZoom are left out
+template<typename Level = ZoomLevel>
+std::vector<std::unique_ptr<Level>> planZoomLevels(const Shot &s, double zoomVal, double density, int maxSize, double minZoom) {
+    std::vector<std::unique_ptr<Level>> levels;
+    const int samples = 1024;
+    for (int i=0; i<=samples; i++) {
+        float prog = float(i)/samples;
+        glm::dvec2 pos = glm::dvec2(lerpVec2(s.pos1, s.pos2, prog));
+        double zoom = std::pow(zoomVal, lerpFloat(s.zoom1, s.zoom2, prog));
+        if (zoom < minZoom) continue;
+        int exponent = zoomExponent(zoom);
+        Level *level = nullptr;
+        for (auto &l : levels) {
+            if (l->exponent == exponent) level = l.get();
+        }
+        // the margin covers the path between samples
+        glm::dvec2 lo = pos - 0.88*zoom, hi = pos + 0.88*zoom;
+        if (level == nullptr) {
+            levels.push_back(std::make_unique<Level>());
+            level = levels.back().get();
+            level->exponent = exponent;
+            level->firstSeen = prog;
+            level->origin = lo;
+            level->extent = hi - lo;
+            continue;
+        }
+        glm::dvec2 end = glm::max(level->origin + level->extent, hi);
+        level->origin = glm::min(level->origin, lo);
+        level->extent = end - level->origin;
+    }
+    for (auto &level : levels) {
+        double pitch = std::ldexp(1.0, level->exponent)/density;
+        level->size = glm::clamp(glm::ivec2(glm::ceil(level->extent/pitch)), glm::ivec2(1), glm::ivec2(maxSize));
+    }
+    std::sort(levels.begin(), levels.end(), [](const auto &a, const auto &b) {return a->firstSeen < b->firstSeen;});
+    return levels;
+}
+
+// fills level.iters in double precision, one row per tile; returns false if stop was set on the way
+inline bool computeZoomLevel(ZoomLevel &level, TileScheduler &scheduler, int maxIters, const std::atomic<bool> &stop) {
+    level.iters.assign(size_t(level.size.x)*level.size.y, 0);
+    std::vector<Tile> rows;
+    for (int y=0; y<level.size.y; y++) rows.push_back({0, y, level.size.x, y+1});
+    glm::dvec2 pitch = level.extent/glm::dvec2(level.size);
+    scheduler.run(rows, [&](const Tile &tile, int) {
+        if (stop) return;
+        double cy = level.origin.y + (tile.y0 + 0.5)*pitch.y;
+        uint32_t *row = &level.iters[size_t(tile.y0)*level.size.x];
+        for (int x=0; x<level.size.x; x++) {
+            row[x] = (uint32_t)escapeItersD(level.origin.x + (x + 0.5)*pitch.x, cy, maxIters);
+        }
+    });
+    return !stop;
+}
+
+// count of the texel nearest to c, clamped to the level
+inline int zoomLevelIters(const ZoomLevel &level, glm::dvec2 c) {
+    glm::ivec2 t = glm::ivec2(glm::floor((c - level.origin)/level.extent*glm::dvec2(level.size)));
+    t = glm::clamp(t, glm::ivec2(0), level.size - 1);
+    return (int)level.iters[size_t(t.y)*level.size.x + t.x];
+}
+
+// colour at c, the colours of the four texels around it blended bilinearly (counts do not interpolate);
+// false if c is outside the level
+inline bool zoomLevelColour(const ZoomLevel &level, glm::dvec2 c, int maxIters, int banding, glm::vec3 c1, glm::vec3 c2, glm::vec3 &colour) {
+    glm::dvec2 f = (c - level.origin)/level.extent*glm::dvec2(level.size) - 0.5;
+    if (f.x < -0.5 || f.y < -0.5 || f.x > level.size.x - 0.5 || f.y > level.size.y - 0.5) return false;
+    glm::ivec2 i0 = glm::ivec2(glm::floor(f));
+    glm::vec2 w = glm::vec2(f - glm::floor(f));
+    colour = glm::vec3(0.0f);
+    for (int j=0; j<2; j++) {
+        for (int i=0; i<2; i++) {
+            glm::ivec2 t = glm::clamp(i0 + glm::ivec2(i, j), glm::ivec2(0), level.size - 1);
+            float weight = (i == 0 ? 1.0f - w.x : w.x)*(j == 0 ? 1.0f - w.y : w.y);
+            int iters = (int)level.iters[size_t(t.y)*level.size.x + t.x];
+            colour += weight*bandColour(iters, maxIters, banding, c1, c2);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include "../include/glm/glm.hpp"
+#include "../include/escape.h"
+#include "../include/simdEscape.h"
+#include "../include/tileScheduler.h"
+#include "../include/deepZoom.h"
+
+/*
+Escape kernel benchmark:
+    Overview:
+        Times every escape-time kernel on fixed grids of c values and prints one line per run:
+        region, kernel, maxIters, threads, time (best of up to 10 runs), ns per pixel, ns per iteration, speedup over one
+        thread and parallel efficiency (speedup/threads).
+        Iterations are counted as a plain loop would run them (escape step + 1, or maxIters), so kernels
+        that skip work (cardioid test, cycle detection, BLA) show up as cheaper per iteration.
+    Usage:
+        ./bench [options]
+        --size n        grid of n x n pixels per region (default 64)
+        --iters list    maxIters values (default 100,1000,10000,100000,1000000)
+        --threads list  thread counts (default 1, 2, 4 ... up to every core)
+        --kernels list  any of float, double, sse, avx2, avx512, deep, deepexp (default: all the CPU runs)
+        --regions list  any of interior, boundary, exterior (default all)
+    Regions:
+        interior        period-3 bulb around (-0.122, 0.745), almost nothing escapes
+        boundary        the second built-in shot at (-1.35653, 0.0685965), scrollVal -29
+        exterior        (1.5, 1.5) and around, everything escapes in a few iterations
+*/
+
+struct Region {
+    const char *name;
+    glm::dvec2 centre;
+    double width;
+};
+
+const Region regions[] = {
+    {"interior", {-0.122, 0.745}, 0.05},
+    {"boundary", {-1.35653, 0.0685965}, 0.00155},
+    {"exterior", {1.5, 1.5}, 0.5}
+};
+
+// one kernel run on rows [y0, y1) of the grid
+typedef std::function<void(int y0, int y1, int maxIters)> KernelRows;
+
+static bool parseList(const std::string &list, std::vector<std::string> &out) {
+    out.clear();
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return !out.empty();
+}
+
+static bool contains(const std::vector<std::string> &list, const std::string &name) {
+    return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+int main(int argc, char **argv) {
+    int size = 64;
+    std::vector<std::string> itersList = {"100", "1000", "10000", "100000", "1000000"};
+    std::vector<std::string> threadsList;
+    std::vector<std::string> kernels;
+    std::vector<std::string> regionNames;
+
+    for (int i=1; i<argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i+1 < argc ? argv[i+1] : "";
+        if (!strcmp(arg, "--size")) {size = atoi(val); i++;}
+        else if (!strcmp(arg, "--iters")) {parseList(val, itersList); i++;}
+        else if (!strcmp(arg, "--threads")) {parseList(val, threadsList); i++;}
+        else if (!strcmp(arg, "--kernels")) {parseList(val, kernels); i++;}
+        else if (!strcmp(arg, "--regions")) {parseList(val, regionNames); i++;}
+        else {
+            std::cout << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    if (size < 1) size = 1;
+    std::vector<int> threadCounts;
+    for (const std::string &t : threadsList) threadCounts.push_back(std::max(1, atoi(t.c_str())));
+    if (threadCounts.empty()) {
+        int cores = std::max(1u, std::thread::hardware_concurrency());
+        for (int n=1; n<cores; n*=2) threadCounts.push_back(n);
+        threadCounts.push_back(cores);
+    }
+
+    SimdLevel best = detectSimd();
+    std::cout << "Grid " << size << "x" << size << ", widest instruction set " << simdName(best) << "\n";
+    printf("%-9s %-8s %8s %7s %10s %10s %9s %7s %6s\n", "region", "kernel", "maxIters", "threads", "ms", "ns/pixel", "ns/iter", "speedup", "eff");
+
+    for (const Region &region : regions) {
+        if (!contains(regionNames, region.name)) continue;
+        // c of every pixel, row by row
+        std::vector<float> cx(size_t(size)*size), cy(size_t(size)*size);
+        std::vector<glm::vec2> unit(size_t(size)*size);
+        for (int y=0; y<size; y++) {
+            for (int x=0; x<size; x++) {
+                glm::vec2 u((x+0.5f)/size - 0.5f, (y+0.5f)/size - 0.5f);
+                unit[size_t(y)*size + x] = u;
+                cx[size_t(y)*size + x] = (float)(region.centre.x + u.x*region.width);
+                cy[size_t(y)*size + x] = (float)(region.centre.y + u.y*region.width);
+            }
+        }
+        std::vector<int> iters(size_t(size)*size);
+
+        for (const std::string &itersText : itersList) {
+            int maxIters = atoi(itersText.c_str());
+            // the deep zoom engines need a reference orbit and BLA table per maxIters, set up untimed
+            Frame f;
+            f.mat = glm::mat4(1.0f);
+            f.effectMat = glm::mat4(1.0f);
+            f.zoom = region.width;
+            f.scaled = scaledZoom(region.width, 1.0);
+            f.pos = region.centre;
+            f.maxIters = maxIters;
+            DeepZoom<double> deep;
+            DeepZoom<FloatExp> deepExp;
+
+            std::vector<std::pair<std::string, KernelRows>> runs;
+            if (contains(kernels, "float")) {
+                runs.push_back({"float", [&](int y0, int y1, int m) {
+                    for (size_t p=size_t(y0)*size; p<size_t(y1)*size; p++) iters[p] = escapeIters(cx[p], cy[p], m);
+                }});
+            }
+            if (contains(kernels, "double")) {
+                runs.push_back({"double", [&](int y0, int y1, int m) {
+                    for (int y=y0; y<y1; y++) {
+                        for (int x=0; x<size; x++) {
+                            size_t p = size_t(y)*size + x;
+                            iters[p] = escapeItersD(region.centre.x + unit[p].x*region.width, region.centre.y + unit[p].y*region.width, m);
+                        }
+                    }
+                }});
+            }
+            for (int level=SIMD_SSE; level<=best; level++) {
+                const char *name = simdName((SimdLevel)level);
+                if (!contains(kernels, name)) continue;
+                EscapeBatchFn fn = escapeBatchFor((SimdLevel)level);
+                runs.push_back({name, [&, fn](int y0, int y1, int m) {
+                    size_t p = size_t(y0)*size;
+                    fn(&cx[p], &cy[p], &iters[p], (y1-y0)*size, m);
+                }});
+            }
+            if (contains(kernels, "deep")) {
+                deep.prepare(f, 0.75);
+                runs.push_back({"deep", [&](int y0, int y1, int m) {
+                    long long skipped = 0;
+                    for (size_t p=size_t(y0)*size; p<size_t(y1)*size; p++) iters[p] = deep.iterate(unit[p], m, skipped);
+                }});
+            }
+            if (contains(kernels, "deepexp")) {
+                deepExp.prepare(f, 0.75);
+                runs.push_back({"deepexp", [&](int y0, int y1, int m) {
+                    long long skipped = 0;
+                    for (size_t p=size_t(y0)*size; p<size_t(y1)*size; p++) iters[p] = deepExp.iterate(unit[p], m, skipped);
+                }});
+            }
+
+            for (auto &run : runs) {
+                // time of the run on threads workers, best of up to 10 repeats within 100ms to keep noise out
+                auto timeRun = [&](int threads) {
+                    // contiguous bands of rows, as large as the renderer's 32x32 tiles at least, so the SIMD kernels
+                    // see batches like they do in headless instead of paying the lane refill tail every row
+                    int bands = threads == 1 ? 1 : std::min(threads*4, std::max(1, size*size/1024));
+                    int bandRows = (size + bands-1)/bands;
+                    std::vector<Tile> rows;
+                    for (int y=0; y<size; y+=bandRows) rows.push_back({0, y, size, std::min(y+bandRows, size)});
+                    TileScheduler scheduler(threads);
+                    double ms = 0.0, total = 0.0;
+                    for (int rep=0; rep<10 && total < 100.0; rep++) {
+                        auto begin = std::chrono::steady_clock::now();
+                        scheduler.run(rows, [&](const Tile &tile, int) {
+                            run.second(tile.y0, tile.y1, maxIters);
+                        });
+                        double repMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                        ms = rep == 0 ? repMs : std::min(ms, repMs);
+                        total += repMs;
+                    }
+                    return ms;
+                };
+                // speedup and efficiency are against a measured single thread run
+                double single = timeRun(1);
+                for (int threads : threadCounts) {
+                    double ms = threads == 1 ? single : timeRun(threads);
+                    double work = 0.0;
+                    for (int it : iters) work += it >= maxIters-1 ? maxIters : std::min(it+2, maxIters);
+                    double speedup = single/ms;
+                    printf("%-9s %-8s %8d %7d %10.2f %10.1f %9.4g %7.2f %6.2f\n", region.name, run.first.c_str(), maxIters, threads,
+                           ms, ms*1e6/iters.size(), work > 0.0 ? ms*1e6/work : 0.0, speedup, speedup/threads);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    return 0;
+}
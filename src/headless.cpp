@@ -0,0 +1,203 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include "../include/glm/glm.hpp"
+#include "../include/camera.h"
+#include "../include/scene.h"
+#include "../include/cpuRenderer.h"
+#include "../include/zoomLevels.h"
+
+/*
+Headless renderer:
+    Overview:
+        Plays the same shot timeline as the windowed program, renders it on the CPU and writes every
+        frame to disk as a PPM image. Needs no window, GL context or GPU.
+    Usage:
+        ./headless [options]
+        --frames n      number of frames to render (default 1)
+        --fps f         timeline frames per second (default 30)
+        --start t       timeline time of the first frame in seconds (default 0)
+        --size WxH      window size the frame is rendered for (default 1000x1000)
+        --ssaa n        supersampling level (default 1)
+        --iters n       maxIters (default 1000)
+        --threads n     worker threads, 0 uses every core (default 0)
+        --tile n        tile size in pixels (default 32, 128 with --guess)
+        --order o       tile order: hilbert, morton or rows (default hilbert)
+        --affinity list pin worker threads to these cpus, e.g. 0-7 or 0,2,4,6 (default: not pinned)
+        --guess         solid guessing: fill rectangles whose border has one iteration count (not exact)
+        --simd isa      escape kernel: scalar, sse, avx2 or avx512 (default: widest the CPU supports)
+        --deep z        perturbation/BLA engine below zoom z, for deep zooms (default 1e-5, 0 never, inf always)
+        --explore x,y,s fixed exploration mode view at pos (x, y) and scrollVal s
+        --keyframes d   zoom video mode: the escape loop only runs for one keyframe per 2x of zoom, a grid of
+                        d texels per unit of (c - pos)/zoom (0 picks 0.75 x the frame size), and every frame
+                        is resampled from the two keyframes around its zoom
+        --out prefix    output file prefix (default frame), frames are written as prefix0000.ppm
+*/
+
+int scrX = 1000;
+int scrY = 1000;
+int ssaa = 1;
+
+Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+double scrollVal = 0.0;
+double zoomVal = 1.25;
+glm::dvec2 pos(-1.4013, 0.00041294);
+bool explorationMode = false;
+
+// Render settings
+int maxIters = 1000;
+glm::vec3 colour1(0.0f, 0.0f, 0.0f);
+glm::vec3 colour2(0.0f, 1.0f, 1.0f);
+int banding = 25;
+
+int main(int argc, char **argv) {
+    int frames = 1;
+    float fps = 30.0f;
+    float start = 0.0f;
+    int threads = 0;
+    std::string out = "frame";
+    std::string simd;
+    std::string order;
+    std::string affinity;
+    int tileSize = 0;
+    bool guess = false;
+    double deepZoom = 1e-5;
+    bool keyframes = false;
+    double keyDensity = 0.0;
+
+    for (int i=1; i<argc; i++) {
+        const char *arg = argv[i];
+        const char *val = i+1 < argc ? argv[i+1] : "";
+        if (!strcmp(arg, "--frames")) {frames = atoi(val); i++;}
+        else if (!strcmp(arg, "--fps")) {fps = atof(val); i++;}
+        else if (!strcmp(arg, "--start")) {start = atof(val); i++;}
+        else if (!strcmp(arg, "--size")) {sscanf(val, "%dx%d", &scrX, &scrY); i++;}
+        else if (!strcmp(arg, "--ssaa")) {ssaa = atoi(val); i++;}
+        else if (!strcmp(arg, "--iters")) {maxIters = atoi(val); i++;}
+        else if (!strcmp(arg, "--threads")) {threads = atoi(val); i++;}
+        else if (!strcmp(arg, "--out")) {out = val; i++;}
+        else if (!strcmp(arg, "--simd")) {simd = val; i++;}
+        else if (!strcmp(arg, "--tile")) {tileSize = atoi(val); i++;}
+        else if (!strcmp(arg, "--order")) {order = val; i++;}
+        else if (!strcmp(arg, "--affinity")) {affinity = val; i++;}
+        else if (!strcmp(arg, "--guess")) guess = true;
+        else if (!strcmp(arg, "--deep")) {deepZoom = atof(val); i++;}
+        else if (!strcmp(arg, "--keyframes")) {keyframes = true; keyDensity = atof(val); i++;}
+        else if (!strcmp(arg, "--explore")) {
+            sscanf(val, "%lf,%lf,%lf", &pos.x, &pos.y, &scrollVal);
+            explorationMode = true;
+            i++;
+        }
+        else {
+            std::cout << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    if (ssaa < 1) ssaa = 1;
+    int fbX = scrX * ssaa;
+    int fbY = scrY * ssaa;
+
+    std::vector<Shot> shots = defaultShots();
+    // solid guessing needs room to find large solid rectangles
+    if (tileSize < 1) tileSize = guess ? 128 : 32;
+    CpuRenderer renderer(threads, tileSize);
+    renderer.guess = guess;
+    renderer.deepZoom = deepZoom;
+    if (!simd.empty() && !parseSimd(simd, renderer.simd)) {
+        std::cout << "Unknown instruction set " << simd << "\n";
+        return 1;
+    }
+    if (!order.empty() && !parseOrder(order, renderer.order)) {
+        std::cout << "Unknown tile order " << order << "\n";
+        return 1;
+    }
+    if (!affinity.empty() && !parseCpuList(affinity, renderer.scheduler.cpus)) {
+        std::cout << "Bad cpu list " << affinity << "\n";
+        return 1;
+    }
+    CpuImage fb, screen;
+    fb.resize(fbX, fbY);
+
+    // zoom video: keyframe levels of the shot playing, computed when a frame first needs them
+    if (keyDensity <= 0.0) keyDensity = 0.75*std::max(fbX, fbY);
+    int keyShot = -1;
+    std::vector<std::unique_ptr<ZoomLevel>> keyLevels;
+    std::atomic<bool> noStop{false};
+    double keyTexels = 0.0, framePixels = 0.0;
+
+    std::cout << "Rendering " << frames << " frame(s) at " << fbX << "x" << fbY << " on "
+              << renderer.scheduler.threads << " thread(s), " << simdName(renderer.simd) << " kernel\n";
+
+    for (int frame=0; frame<frames; frame++) {
+        float t = start + frame/fps;
+        int shot = -1;
+        if (!explorationMode) shot = sampleShots(shots, t, pos, scrollVal);
+
+        Frame f;
+        f.mat = cubeMatrix(camera, t, explorationMode, scrX, scrY);
+        f.effectMat = effectMatrix(t, explorationMode);
+        f.zoom = pow(zoomVal, scrollVal);
+        f.scaled = scaledZoom(zoomVal, scrollVal);
+        f.pos = pos;
+        f.maxIters = maxIters;
+        f.c1 = colour1;
+        f.c2 = colour2;
+        f.banding = banding;
+
+        auto begin = std::chrono::steady_clock::now();
+        bool resampled = false;
+        if (keyframes && shot >= 0) {
+            if (shot != keyShot) {
+                keyLevels = planZoomLevels(shots[shot], zoomVal, keyDensity, 8192, 1e-12);
+                keyShot = shot;
+            }
+            // the level of this zoom has every c of the frame, the one below adds detail as zoom nears it
+            int exponent = zoomExponent(f.zoom);
+            ZoomLevel *coarse = nullptr, *fine = nullptr;
+            for (auto &level : keyLevels) {
+                if (level->exponent == exponent) coarse = level.get();
+                else if (level->exponent == exponent-1) fine = level.get();
+                // levels the shot has moved past
+                else std::vector<uint32_t>().swap(level->iters);
+            }
+            if (coarse) {
+                for (ZoomLevel *level : {coarse, fine}) {
+                    if (!level || !level->iters.empty()) continue;
+                    computeZoomLevel(*level, renderer.scheduler, maxIters, noStop);
+                    keyTexels += double(level->size.x)*level->size.y;
+                }
+                float fineWeight = 1.0f - float(std::log2(f.zoom) - exponent);
+                renderer.renderResampled(f, fb, *coarse, fine, fineWeight);
+                resampled = true;
+            }
+        }
+        if (!resampled) {
+            renderer.render(f, fb);
+            keyTexels += double(fbX)*fbY;
+        }
+        framePixels += double(fbX)*fbY;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        char name[32];
+        snprintf(name, sizeof(name), "%04d.ppm", frame);
+        std::string path = out + name;
+        if (ssaa > 1) {
+            downsample(fb, screen, ssaa);
+            if (!writePPM(path, screen)) std::cout << "Could not write " << path << "\n";
+        }
+        else if (!writePPM(path, fb)) std::cout << "Could not write " << path << "\n";
+        std::cout << path << "  t=" << t << "  " << ms << "ms";
+        if (guess) std::cout << "  " << renderer.guessed << " pixels guessed";
+        if (f.zoom < deepZoom && !resampled) std::cout << "  " << renderer.skipped << " iterations skipped";
+        if (resampled) std::cout << "  resampled";
+        std::cout << "\n";
+    }
+    if (keyframes) {
+        std::cout << "Escape loop ran for " << keyTexels << " points, " << framePixels << " frame pixels ("
+                  << (keyTexels > 0.0 ? framePixels/keyTexels : 0.0) << " frame pixels per point)\n";
+    }
+    return 0;
+}
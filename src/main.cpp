@@ -2,11 +2,24 @@
 #include "../include/glad/glad.h"
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include <cstring>
+#include <climits>
 #include "../include/shader.h"
 #include "../include/glm/glm.hpp"
 #include "../include/glm/gtc/matrix_transform.hpp"
 #include "../include/glm/gtc/type_ptr.hpp"
 #include "../include/camera.h"
+#include "../include/scene.h"
+#include "../include/perturbation.h"
+#include "../include/escape.h"
+#include "../include/gpuTimer.h"
+#include "../include/benchmark.h"
+#include "../include/renderTargets.h"
+#include "../include/resolutionGovernor.h"
+#include "../include/faceTextures.h"
+#include "../include/shotAtlas.h"
+#include <chrono>
+#include <thread>
 
 /*
 How to use:
@@ -19,13 +32,32 @@ How to use:
         Page down to disable it
         WASD keys to move in exploration mode
         Scroll wheel to zoom in/out in exploration mode
+    Command line:
+        --benchmark n   run n frames on a fixed clock without vsync, then print frame time percentiles,
+                        megapixels/s and iterations/s as JSON
+        --fps f         frames per second of the fixed clock (default 60)
+        --json path     write the benchmark JSON here instead of printing it
+        --record path   save the input of every frame (keys, scroll, clock) to path
+        --replay path   play back a recorded input file instead of the keyboard, on its recorded clock
+        --compute       use the compute shader kernel for plain float frames (computeKernel)
+        --buckets n     compute kernel in iteration buckets, n iterations in the first pass (bucketed)
+        --faces         render plain float frames per face into mipmapped textures (faceTextures)
+        --fps-cap f     frames per second cap outside the benchmark (fpsCap)
+        --atlas         precompute the shots on background threads and play them from textures (shotAtlas)
 
     Helpful variables:
         vec2 pos - position of camera
         double zoom - the zoom of the camera
         int scrX, scrY - window size
         int ssaa - level of supersampling anti-aliasing (each level increases frame buffer by n^2)
-        int fbX, fbY - size of frame buffer
+        int adaptiveSamples - above 1, replaces ssaa: the frame buffer stays at window size and only pixels
+                              whose count differs from one of their four neighbours take n x n samples (float
+                              and double-float kernels only: the recolour path is skipped while it is on, and
+                              the perturbation path keeps one sample per pixel)
+        int fbX, fbY - size of frame buffer this frame (scrX*ssaa, scrY*ssaa scaled by dynamic resolution)
+        bool dynamicResolution - scales the frame buffer down when frames take longer than frameBudgetMs
+        float frameBudgetMs - GPU time per frame dynamic resolution aims to stay under
+        float minRenderScale - smallest fraction of scrX*ssaa, scrY*ssaa dynamic resolution goes down to
         double scrollVal - level of zoom
         double zoomVal - how many times zoom increases with every -1 decrease of scrollVal
         float t - time since start of program
@@ -34,28 +66,60 @@ How to use:
         int maxIters - maximum iterations for the mandelbrot algorithm
         vec3 colour1, colour2 - The primary and secondary colours of the render
         int banding - Level of colour banding
+        bool recolour - plain float frames write iteration counts and are coloured in the screen pass
+        bool smoothColour - blends palette entries with the fractional (smooth) iteration count
+        float paletteSpeed - palette entries per second the recolour pass cycles through
+        string timingFile - GPU time of every pass is written to this .csv or .json file, empty disables it
+        bool doubleFloat - enables/disables the double-float (hi/lo float pair) kernel for medium zooms
+        double doubleFloatZoom - zoom below which the double-float kernel takes over from plain floats
+        bool perturbation - enables/disables perturbation rendering for deep zooms
+        double perturbationZoom - zoom below which perturbation rendering takes over from double-float
+        bool visibilityBuffer - the cube is first rasterized into a buffer of face and c per pixel, then the
+                                colour kernels run once per covered pixel as a full screen pass
+        bool computeKernel - plain float frames run as a compute shader with computeGroups persistent workgroups
+                             taking 8x8 tiles from an atomic queue (--compute, implies the visibility buffer)
+        bool bucketed - the compute kernel runs in passes of growing iteration budgets (bucketIters first, 4x
+                        more each pass) over a compacted list of the pixels still bounded
+        bool faceTextures - plain float frames render each face turned to the camera flat into a texture sized
+                            to its area on screen, and draw the cube textured from their mipmaps (--faces);
+                            work no longer grows with ssaa, and a face is only redrawn when its part of the
+                            plane or the colours change
+        float faceAnisotropy - anisotropic filtering samples of the face textures
+        int maxFaceSize - largest side of a face texture
+        bool reprojection - the recolour path reuses the previous frame's counts where c moved less than
+                            reuseTolerance pixels, and only iterates pixels that newly came into view or moved
+        float reuseTolerance - largest distance in pixels between the c of a reused count and the pixel's c
+        bool navigationReuse - in exploration mode the recolour path pans by whole pixels, so a pan reuses the
+                               shifted buffer and only iterates the strips that came into view, and a scroll
+                               step first shows the previous buffer resampled as a preview, refined next frame
+        bool refine - a still view in exploration mode keeps refining: higher iteration cap, then jittered
+                      samples averaged for anti-aliasing; any change to the view or colours restarts it
+        int refineDoublings - times the iteration cap of a still view doubles (from maxIters)
+        int refineSamples - jittered samples averaged once the iteration cap is reached
+        bool redrawOnChange - once a still exploration view is drawn (and refined), nothing is rendered and the
+                              loop sleeps until input arrives or the view changes
+        float fpsCap - most frames per second outside the benchmark, 0 for no cap
+        bool shotAtlas - every shot's iteration counts are precomputed on background threads, one level per
+                         power of two of zoom, and shots then play by sampling them (not in the benchmark)
+        double atlasDensity - texels of a shot atlas level per unit of (c - pos)/zoom
+        int atlasThreads - threads computing the shot atlas, 0 for every core but one
         vector<Shot> shots - vector of camera shots that play when exploration mode is disabled
 
     Notes:
         This program began as a simple 2d mandelbrot explorer (ver 1, 2) but became a rotating mandelbrot
         cube (ver 3+)
-        Anything mentioning 64 bits is vestigial - from an attempt to implement a double precision
-        rendering mode (failed) before implementation of 3d.
+        The old 64 bit mode (an attempt at double precision before implementation of 3d) is replaced by
+        perturbation rendering: one reference orbit is iterated on the cpu in high precision and every
+        pixel only iterates its float difference to it, so zooms go far past what floats or doubles hold.
 */
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
-glm::vec2 lerpVec2(glm::vec2 v1, glm::vec2 v2, float t);
-float lerpFloat(float a, float b, float t);
-
-struct Shot {
-    glm::vec2 pos1;
-    glm::vec2 pos2;
-    float zoom1;
-    float zoom2;
-    float t;
-};
+void refresh_callback(GLFWwindow* window);
+void processInput(GLFWwindow *window, InputFrame &input, bool replaying);
+glm::vec2 splitDouble(double v);
+glm::dvec2 pixelPitch(const glm::mat4 &mat, int width, int height);
+float halton(int index, int base);
 
 float fPI = 3.141592653;
 double dPI = 3.141592653;
@@ -65,7 +129,13 @@ int scrY = 1000;
 int ssaa = 1;
 int fbX = scrX * ssaa;
 int fbY = scrY * ssaa;
-int bits = 32;
+// adaptive supersampling: frame buffer at window size, a count pass then a pass giving n x n samples to
+// the pixels next to another count (float and double-float kernels, off for recolour and perturbation)
+int adaptiveSamples = 0;
+// lower the resolution of heavy frames to stay inside the frame budget
+bool dynamicResolution = true;
+float frameBudgetMs = 14.0f;
+float minRenderScale = 0.5f;
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
@@ -75,6 +145,7 @@ double zoom = 1.0f;
 glm::dvec2 pos(-1.4013, 0.00041294);
 float t;
 float dt;
+// start of the shot timeline, enter restarts it
 float shotTime = 0.0f;
 bool explorationMode = false;
 
@@ -83,6 +154,96 @@ int maxIters = 1000;
 glm::vec3 colour1(0.0f, 0.0f, 0.0f);
 glm::vec3 colour2(0.0f, 1.0f, 1.0f);
 int banding = 25;
+bool recolour = true;
+bool smoothColour = false;
+float paletteSpeed = 0.0f;
+std::string timingFile = "";
+bool doubleFloat = true;
+double doubleFloatZoom = 1e-3;
+bool perturbation = true;
+double perturbationZoom = 1e-11;
+// visibility buffer: the cube is rasterized into c offsets first and the colour kernels run once per
+// covered pixel in a full screen pass, instead of per fragment of every face drawn
+bool visibilityBuffer = true;
+// compute shader path for plain float frames: persistent workgroups pulling tiles from an atomic counter
+bool computeKernel = false;
+int computeGroups = 256;
+// iteration buckets for the compute kernel: a first pass of bucketIters iterations over every pixel, then
+// passes with 4x the budget over only the pixels still bounded
+bool bucketed = false;
+int bucketIters = 256;
+// per face rendering: faces turned to the camera are rendered into mipmapped textures of their own
+bool faceTextures = false;
+float faceAnisotropy = 8.0f;
+int maxFaceSize = 4096;
+// shot atlas: the iteration counts of every shot computed ahead on background threads, playback samples them
+bool shotAtlas = false;
+double atlasDensity = 384.0;
+int atlasThreads = 0;
+// temporal reprojection: fresh iteration buffers reuse counts of the last one whose c is within
+// reuseTolerance pixels
+bool reprojection = true;
+float reuseTolerance = 0.25f;
+// pans snap to whole pixels and scroll steps show a resampled preview first, so navigating in exploration
+// mode only iterates the area that is new
+bool navigationReuse = true;
+// progressive refinement of a still view in exploration mode: the iteration cap doubles refineDoublings
+// times, then refineSamples jittered samples are averaged
+bool refine = true;
+int refineDoublings = 3;
+int refineSamples = 32;
+// render on change: a finished still view stays on screen and the loop waits for events instead of drawing
+bool redrawOnChange = true;
+// frames per second cap outside the benchmark, 0 leaves it to vsync
+float fpsCap = 0.0f;
+// the window needs redrawing even though nothing changed (uncovered, restored)
+bool windowDamaged = false;
+// extra references tried for pixels the first reference could not render
+int maxGlitchPasses = 8;
+
+// view of the iteration buffer, it is only redrawn when one of them changes (maxIters going up only
+// continues the pixels that have not escaped yet)
+struct CubeInputs {
+    glm::mat4 mat;
+    glm::mat4 effect;
+    double zoom;
+    glm::dvec2 pos;
+    int width, height;
+
+    bool operator==(const CubeInputs &other) const = default;
+};
+
+// inputs of a frame in exploration mode, a frame equal to the last one drawn is not drawn again
+struct ViewInputs {
+    glm::dvec2 pos;
+    double scrollVal;
+    int maxIters;
+    glm::vec3 c1, c2;
+    int banding;
+    bool smoothColour;
+    bool explorationMode;
+    int width, height;
+
+    bool operator==(const ViewInputs &other) const = default;
+};
+
+// everything the image of a still view depends on, refinement starts over when any of it changes
+struct RefineInputs {
+    glm::mat4 mat;
+    glm::mat4 effect;
+    double zoom;
+    glm::dvec2 pos;
+    int maxIters;
+    glm::vec3 c1, c2;
+    int banding;
+    bool smoothColour;
+    float paletteOffset;
+    int width, height;
+    // size rendered at, samples of different sizes do not add up
+    int renderWidth, renderHeight;
+
+    bool operator==(const RefineInputs &other) const = default;
+};
 
 float rect[] = {
     // Position        // UV
@@ -95,54 +256,42 @@ float rect[] = {
      1.0f, 1.0f, 0.0f, 1.0f, 1.0f
 };
 
-float cube[] = {
-    // Position           // Texture   // Normal
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  0.0f, -1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,  0.0f,  0.0f, -1.0f,
-
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  0.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,  0.0f,  0.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,  0.0f,  0.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,  0.0f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  0.0f, 1.0f,
-
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, -1.0f,  0.0f,  0.0f,
-
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  1.0f,  0.0f,  0.0f,
-
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,  0.0f, -1.0f,  0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,  0.0f, -1.0f,  0.0f,
-
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  1.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,  0.0f,  1.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,  0.0f,  1.0f,  0.0f,
-};
+double pendingScroll = 0.0;
 
-int main() {
+int main(int argc, char **argv) {
     std::cout << "Mandelbrot Test\n";
 
+    int benchmarkFrames = 0;
+    float benchmarkFps = 60.0f;
+    std::string benchmarkJson;
+    std::string recordPath;
+    std::string replayPath;
+    for (int i=1; i<argc; i++) {
+        std::string arg = argv[i];
+        std::string val = i+1 < argc ? argv[i+1] : "";
+        if (arg == "--benchmark") {benchmarkFrames = atoi(val.c_str()); i++;}
+        else if (arg == "--fps") {benchmarkFps = atof(val.c_str()); i++;}
+        else if (arg == "--json") {benchmarkJson = val; i++;}
+        else if (arg == "--record") {recordPath = val; i++;}
+        else if (arg == "--replay") {replayPath = val; i++;}
+        else if (arg == "--compute") computeKernel = true;
+        else if (arg == "--faces") faceTextures = true;
+        else if (arg == "--atlas") shotAtlas = true;
+        else if (arg == "--fps-cap") {fpsCap = atof(val.c_str()); i++;}
+        else if (arg == "--buckets") {computeKernel = bucketed = true; bucketIters = std::max(1, atoi(val.c_str())); i++;}
+        else {
+            std::cout << "Unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    bool benchmark = benchmarkFrames > 0;
+    InputLog inputLog;
+    bool replaying = !replayPath.empty();
+    if (replaying && !inputLog.load(replayPath)) {
+        std::cout << "Could not read " << replayPath << "\n";
+        return 1;
+    }
+
     // init glfw
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -159,6 +308,9 @@ int main() {
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
+    // frame times should measure rendering, not waiting for vsync
+    if (benchmark) glfwSwapInterval(0);
     //glEnable(GL_DEPTH_TEST);
 
     // init glad
@@ -173,42 +325,53 @@ int main() {
     // init viewport
     glViewport(0, 0, scrX, scrY);
 
-    Shader shader32("shaders/p32/vShader32.glsl", "shaders/p32/fShader32.glsl");
-    Shader shader64("shaders/p64/vShader64.glsl", "shaders/p64/fShader64.glsl");
+    Shader shader32Cube("shaders/p32/vShader32.glsl", "shaders/p32/fShader32.glsl");
+    Shader shader32Iters("shaders/p32/vShader32.glsl", "shaders/p32/fShader32Iters.glsl");
+    Shader shaderDFCube("shaders/df/vShaderDF.glsl", "shaders/df/fShaderDF.glsl");
+    Shader shaderPertCube("shaders/pert/vShaderPert.glsl", "shaders/pert/fShaderPert.glsl");
     Shader screenShader("shaders/screen/vScreen.glsl", "shaders/screen/fScreen.glsl");
+    // visibility buffer pipeline: the cube pass and the kernels as full screen passes over its result
+    Shader visShader("shaders/vis/vVis.glsl", "shaders/vis/fVis.glsl");
+    Shader shader32Vis("shaders/vis/vResolve.glsl", "shaders/p32/fShader32.glsl");
+    Shader shaderDFVis("shaders/vis/vResolve.glsl", "shaders/df/fShaderDF.glsl");
+    Shader shaderPertVis("shaders/vis/vResolve.glsl", "shaders/pert/fShaderPert.glsl");
+    Shader tileShader("shaders/compute/cEscape.glsl");
+    Shader bucketShader("shaders/compute/cBucket.glsl");
+    // per face rendering: the float kernel over a face texture, and the cube textured from them
+    Shader faceShader("shaders/face/vFace.glsl", "shaders/p32/fShader32.glsl");
+    Shader faceCubeShader("shaders/face/vFaceCube.glsl", "shaders/face/fFaceCube.glsl");
+    Shader atlasShader("shaders/vis/vVis.glsl", "shaders/atlas/fAtlas.glsl");
 
-    // create frame buffer object
-    GLuint fbo;
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    // create colour texture
-    GLuint colorTex;
-    glGenTextures(1, &colorTex);
-    glBindTexture(GL_TEXTURE_2D, colorTex);
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F, fbX, fbY, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
-    GLuint depthRBO;
-    glGenRenderbuffers(1, &depthRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
-    glRenderbufferStorage(
-        GL_RENDERBUFFER,
-        GL_DEPTH_COMPONENT24,
-        fbX,
-        fbY
-    );
-
-    glFramebufferRenderbuffer(
-        GL_FRAMEBUFFER,
-        GL_DEPTH_ATTACHMENT,
-        GL_RENDERBUFFER,
-        depthRBO
-    );
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "FBO not complete.\n";
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // screen sized targets of the cube passes, sized in the render loop
+    RenderTargets targets;
+    FaceTextures faces;
+    faces.anisotropy = faceAnisotropy;
+    ResolutionGovernor governor(frameBudgetMs, minRenderScale);
+    CubeInputs lastCube = {};
+    lastCube.zoom = -1.0;
+    // highest maxIters the iteration buffer has been computed for
+    int itersDone = 0;
+    // the iteration buffer holds a zoom preview, the next frame computes it properly
+    bool previewed = false;
+    // palette of the recolour pass, rebuilt when the colours or banding change
+    GLuint paletteTex;
+    glGenTextures(1, &paletteTex);
+    glBindTexture(GL_TEXTURE_1D, paletteTex);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glm::vec3 paletteC1(-1.0f), paletteC2(-1.0f);
+    int paletteBanding = -1;
+
+    // reference orbit and glitch counter for perturbation rendering
+    GLuint orbitSSBO, glitchSSBO;
+    glGenBuffers(1, &orbitSSBO);
+    glGenBuffers(1, &glitchSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, glitchSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 4*sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    ReferenceOrbit orbit;
+    orbit.maxIters = -1;
+    std::vector<glm::vec2> orbitData;
 
     // create rect vbo, vao
     unsigned int rectVBO, rectVAO;
@@ -231,25 +394,101 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float)));
     glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
     glBindVertexArray(0);
 
-    std::vector<Shot> shots = {
-        {{-1.4013f, 0.00041294f}, {-1.4013f, 0.00041294f}, -12.0f, -65.0f, 30.0f},
-        {{-1.35653, 0.0685965}, {-1.36048, 0.0710716}, -29.0f, -29.0f, 40.0f}
-    };
+    std::vector<Shot> shots = defaultShots();
+    ShotAtlas atlas;
+    atlas.density = atlasDensity;
 
     float prevTime = 0.0f;
-    int shotIndex = 0;
+
+    GpuTimer gpuTimer;
+    if (!timingFile.empty() && !gpuTimer.open(timingFile)) {
+        std::cout << "Could not open " << timingFile << "\n";
+    }
+    long long frame = 0;
+
+    // escape loop iterations of the frame, counted by the cube shaders in benchmark mode
+    GLuint iterationSSBO;
+    glGenBuffers(1, &iterationSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, iterationSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2*sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    BenchmarkStats stats;
+
+    // tile counter of the compute kernel
+    GLuint tileQueueSSBO;
+    glGenBuffers(1, &tileQueueSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileQueueSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    // survivor lists and their counts for the bucketed compute kernel, sized when first used
+    GLuint survivorSSBO[2], survivorCountSSBO;
+    glGenBuffers(2, survivorSSBO);
+    glGenBuffers(1, &survivorCountSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, survivorCountSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2*sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    GLsizeiptr survivorCapacity = 0;
+
+    ViewInputs lastView = {};
+    std::string lastTitle;
+    RefineInputs lastRefine = {};
+    // frames the current view has been still for
+    int refineFrame = 0;
 
     while(!glfwWindowShouldClose(window)) {
-        t = (float)glfwGetTime();
-        dt = t - prevTime;
+        auto frameStart = std::chrono::steady_clock::now();
+        InputFrame input;
+        if (replaying) {
+            if (frame >= (long long)inputLog.frames.size()) break;
+            input = inputLog.frames[frame];
+            t = input.t;
+            dt = input.dt;
+        }
+        else if (benchmark) {
+            // fixed clock so every run animates the same
+            t = frame/benchmarkFps;
+            dt = 1.0f/benchmarkFps;
+        }
+        else {
+            t = (float)glfwGetTime();
+            dt = t - prevTime;
+        }
         prevTime = t;
+        input.t = t;
+        input.dt = dt;
         float fps = 1.0/dt;
-        processInput(window);
+        processInput(window, input, replaying);
+        if (!recordPath.empty()) inputLog.frames.push_back(input);
+        // a still exploration view that is already on screen (and done refining) is left there: nothing in
+        // it moves with t unless the palette cycles, so the loop just waits for the next event
+        ViewInputs view = {pos, scrollVal, maxIters, colour1, colour2, banding, smoothColour, explorationMode, scrX, scrY};
+        bool refineDone = !refine || refineFrame - refineDoublings >= std::max(refineSamples, 1);
+        if (redrawOnChange && explorationMode && !benchmark && !replaying && paletteSpeed == 0.0f &&
+            refineDone && !windowDamaged && !previewed && view == lastView) {
+            glfwWaitEventsTimeout(0.25);
+            // time spent waiting is not movement time for the next frame
+            prevTime = (float)glfwGetTime();
+            continue;
+        }
+        lastView = view;
+        windowDamaged = false;
+        // the targets follow the window, the governor picks how much of them this frame uses
+        // (a minimised window reports 0 x 0, the targets are kept as they are then)
+        int fbScale = adaptiveSamples > 1 ? 1 : ssaa;
+        if (scrX > 0 && scrY > 0 && targets.resize(scrX*fbScale, scrY*fbScale, scrX, scrY)) lastCube.zoom = -1.0;
+        bool governed = dynamicResolution && !benchmark;
+        if (governed) governor.beginFrame();
+        fbX = governor.scaled(targets.width);
+        fbY = governor.scaled(targets.height);
+        gpuTimer.beginFrame(frame);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, iterationSSBO);
 
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, targets.fbo);
         glViewport(0, 0, fbX, fbY);
 
         //glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
@@ -260,84 +499,561 @@ int main() {
                             std::to_string((int)fps) + "fps  " +
                             std::to_string(int(1.0/zoom)) + "x zoom  " +
                             //std::to_string(int(scrollVal)) + " zoom  " +
-                            std::to_string(maxIters) + " iters";
-        glfwSetWindowTitle(window, title.c_str());
-
-        if (!explorationMode) {
-            Shot s = shots[shotIndex];
-            float shotProg = (t-shotTime) / s.t; // 0.0f - 1.0f
-            if (shotProg > 1.0f) {
-                shotIndex++;
-                shotTime = t;
-                if (shotIndex > shots.size()) {
-                    shotIndex = 0;
-                }
-            }
-        pos = lerpVec2(s.pos1, s.pos2, shotProg);
-        scrollVal = lerpFloat(s.zoom1, s.zoom2, shotProg);
-        //std::cout << scrollVal << "\n";
+                            std::to_string(maxIters) + " iters" +
+                            (governed ? "  " + std::to_string(int(governor.scale*100.0f)) + "% res" : "") +
+                            (refineFrame > 0 ? "  refine " + std::to_string(std::min(refineFrame, refineDoublings+std::max(refineSamples, 1))) : "");
+        if (title != lastTitle) {
+            glfwSetWindowTitle(window, title.c_str());
+            lastTitle = title;
         }
+
+        // the shot timeline loops from shotTime on, as in the headless renderer; playingShot is the shot pos
+        // and scrollVal came from, for the atlas (-1 in exploration mode)
+        int playingShot = -1;
+        if (!explorationMode) playingShot = sampleShots(shots, t - shotTime, pos, scrollVal);
         zoom = pow(zoomVal, scrollVal);
 
-        float angle = 0.0f;
-        glm::mat4 view = glm::mat4(1.0f);
-        view = glm::lookAt(camera.Pos, camera.Pos + camera.Front, camera.Up);
-        glm::mat4 projection;
-        projection = glm::perspective(glm::radians(camera.FOV), (float)scrX/(float)scrY, 0.1f, 100.0f);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -0.0f));
-        if (!explorationMode) angle = glm::radians(17.4538f*t);
-        model = glm::rotate(model, angle, glm::vec3(0.9f, 0.6f, 0.1f));
-        glm::mat4 matrix = projection * view * model;
-
-        glm::mat4 effect = glm::mat4(1.0f);
-        if (!explorationMode) angle = glm::radians(10.123f*t);
-        effect = glm::rotate(effect, angle, glm::vec3(1.0f, 0.3f, 0.5f));
-
-        if (bits == 32) {
+        glm::mat4 matrix = cubeMatrix(camera, t, explorationMode, scrX, scrY);
+        glm::mat4 effect = effectMatrix(t, explorationMode);
+
+        // progressive refinement: frames of a still view first raise the iteration cap, each replacing the
+        // last, then add jittered samples to the accumulation buffer until refineSamples are in
+        float paletteOffset = std::fmod(t*paletteSpeed, (float)std::max(banding, 1));
+        bool refining = refine && explorationMode && !benchmark;
+        RefineInputs refineInputs = {matrix, effect, zoom, pos, maxIters, colour1, colour2, banding, smoothColour, paletteOffset, scrX, scrY,
+                                     lastRefine.renderWidth, lastRefine.renderHeight};
+        // a view that stays still renders at full scale: its samples all have one size, and its raised caps are
+        // not measured, so they do not push the governor down for when it moves again
+        bool pinned = refining && refineFrame > 0 && refineInputs == lastRefine;
+        if (pinned) {
+            fbX = targets.width;
+            fbY = targets.height;
+            glViewport(0, 0, fbX, fbY);
+        }
+        refineInputs.renderWidth = fbX;
+        refineInputs.renderHeight = fbY;
+        if (!refining || !(refineInputs == lastRefine)) {
+            lastRefine = refineInputs;
+            refineFrame = 0;
+        }
+        int frameIters = maxIters;
+        bool jittered = false;
+        int samples = std::max(refineSamples, 1);
+        int sample = refineFrame - refineDoublings;
+        bool converged = refining && sample >= samples;
+        if (refining) {
+            int doublings = std::min(refineFrame, refineDoublings);
+            frameIters = (int)std::min((long long)maxIters << doublings, (long long)INT_MAX/2);
+            if (sample > 0 && !converged) {
+                // sub-pixel offset of the whole projection, in window pixels
+                glm::vec2 jitter(halton(sample, 2) - 0.5f, halton(sample, 3) - 0.5f);
+                glm::vec3 ndc(2.0f*jitter.x/scrX, 2.0f*jitter.y/scrY, 0.0f);
+                matrix = glm::translate(glm::mat4(1.0f), ndc)*matrix;
+                jittered = true;
+            }
+            if (!converged) refineFrame++;
+        }
+
+        ScaledZoom sz = scaledZoom(zoomVal, scrollVal);
+        bool recoloured = false;
+        // false when the cached iteration buffer is only recoloured
+        bool rendered = true;
+        // visibility buffer: the cube is rasterized once into unit offsets and faces, then the kernels below
+        // run as a full screen pass over it (the recolour path has its own depth pre-pass)
+        // shots whose atlas level for this zoom is ready are only sampled (computed for maxIters, so not
+        // while refinement raises it)
+        bool atlasPlayback = shotAtlas && !explorationMode && !benchmark;
+        if (atlasPlayback && atlas.maxIters != maxIters) {
+            int threads = atlasThreads > 0 ? atlasThreads : std::max(1, (int)std::thread::hardware_concurrency() - 1);
+            atlas.start(shots, zoomVal, maxIters, std::max(playingShot, 0), threads);
+        }
+        if (atlasPlayback) atlas.uploadFinished();
+        const AtlasLevel *atlasLevel = atlasPlayback && frameIters == maxIters ? atlas.level(playingShot, zoom) : nullptr;
+        bool atlased = atlasLevel != nullptr;
+        bool pertPath = perturbation && zoom < perturbationZoom;
+        bool dfPath = doubleFloat && zoom < doubleFloatZoom;
+        // face textures, then the compute kernel replace the recolour path for plain float frames
+        bool faced = faceTextures && !pertPath && !dfPath;
+        bool itersPath = !pertPath && recolour && adaptiveSamples <= 1 && !dfPath && !computeKernel && !faced;
+        bool computed = computeKernel && !pertPath && !dfPath && !faced;
+        bool visible = (visibilityBuffer || computed) && !converged && !itersPath && !faced && !atlased;
+        if (visible) {
+            gpuTimer.begin("visibility");
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.visFbo);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glEnable(GL_DEPTH_TEST);
+            visShader.use();
+            visShader.setMat4("mat", matrix);
+            visShader.setMat4("effectMat", effect);
+            glBindVertexArray(cubeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.fbo);
+            glDisable(GL_DEPTH_TEST);
+            // units 0-2 stay with the screen pass
+            glActiveTexture(GL_TEXTURE5);
+            glBindTexture(GL_TEXTURE_2D, targets.visTex);
+            glActiveTexture(GL_TEXTURE6);
+            glBindTexture(GL_TEXTURE_2D, targets.visDerivTex);
+            glActiveTexture(GL_TEXTURE0);
+            gpuTimer.end();
+        }
+        // the cube itself, or a full screen pass over the visibility buffer
+        auto drawCube = [&](const Shader &shader) {
+            shader.setBool("resolve", visible);
+            if (visible) {
+                shader.setInt("visibility", 5);
+                shader.setInt("visibilityDeriv", 6);
+                glBindVertexArray(rectVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }
+            else {
+                glEnable(GL_DEPTH_TEST);
+                glBindVertexArray(cubeVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
+        };
+        // adaptive supersampling: one sample per pixel that also stores its count, then a second pass over
+        // the same pixels that resamples those with a neighbour of another count and discards the rest
+        auto drawAdaptive = [&](const Shader &shader) {
+            shader.setInt("subSamples", adaptiveSamples);
+            shader.setBool("resample", false);
+            if (adaptiveSamples > 1) {
+                GLint none = -1;
+                glClearTexImage(targets.countTex, 0, GL_RED_INTEGER, GL_INT, &none);
+                glBindImageTexture(2, targets.countTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32I);
+            }
+            drawCube(shader);
+            if (adaptiveSamples <= 1) return;
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            shader.setBool("resample", true);
+            glDepthFunc(GL_LEQUAL);
+            drawCube(shader);
+            glDepthFunc(GL_LESS);
+        };
+        gpuTimer.begin("cube");
+        if (converged) {
+            // the accumulation buffer already holds the finished image
+            rendered = false;
+        }
+        else if (atlased) {
             glEnable(GL_DEPTH_TEST);
+            atlasShader.use();
+            atlasShader.setMat4("mat", matrix);
+            atlasShader.setMat4("effectMat", effect);
+            atlasShader.setVec2("atlasOffset", glm::vec2((pos - atlasLevel->origin)/atlasLevel->extent));
+            atlasShader.setVec2("atlasScale", glm::vec2(zoom/atlasLevel->extent));
+            atlasShader.setInt("maxIters", frameIters);
+            atlasShader.setVec3("c1", colour1);
+            atlasShader.setVec3("c2", colour2);
+            atlasShader.setInt("banding", banding);
+            // unit 7, units 0-6 belong to the other passes
+            glActiveTexture(GL_TEXTURE7);
+            glBindTexture(GL_TEXTURE_2D, atlasLevel->tex);
+            atlasShader.setInt("atlas", 7);
+            glActiveTexture(GL_TEXTURE0);
+            glBindVertexArray(cubeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+        else if (pertPath) {
+            Shader &shaderPert = visible ? shaderPertVis : shaderPertCube;
+            shaderPert.use();
+            shaderPert.setFloat("zoomMantissa", (float)sz.mantissa);
+            shaderPert.setInt("zoomExp", sz.exponent);
+            shaderPert.setInt("maxIters", frameIters);
+            shaderPert.setBool("countIters", benchmark);
+            shaderPert.setMat4("mat", matrix);
+            shaderPert.setMat4("effectMat", effect);
+            shaderPert.setVec3("c1", colour1);
+            shaderPert.setVec3("c2", colour2);
+            shaderPert.setInt("banding", banding);
+            shaderPert.setInt("prevPass", 0);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, orbitSSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, glitchSSBO);
+            shaderPert.setBool("depthOnly", false);
+            if (!visible) {
+                // depth first, so only the fragments that stay on screen report glitches
+                glEnable(GL_DEPTH_TEST);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                shaderPert.setBool("depthOnly", true);
+                glBindVertexArray(cubeVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                shaderPert.setBool("depthOnly", false);
+                glDepthFunc(GL_LEQUAL);
+            }
+
+            // the first pass uses a reference at pos, every later pass one inside the glitched pixels
+            glm::vec2 refOffset(0.0f);
+            for (int pass=0; pass<=maxGlitchPasses; pass++) {
+                if (orbit.pos != pos || orbit.offset != glm::dvec2(refOffset) || orbit.offsetExp != sz.exponent ||
+                    orbit.maxIters != frameIters ||
+                    orbit.limbs != orbitLimbs(sz.exponent)) {
+                    orbit = referenceOrbit(pos, glm::dvec2(refOffset), sz.exponent, frameIters, sz.exponent);
+                    orbitData.assign(orbit.z.begin(), orbit.z.end());
+                    glBindBuffer(GL_SHADER_STORAGE_BUFFER, orbitSSBO);
+                    glBufferData(GL_SHADER_STORAGE_BUFFER, orbitData.size()*sizeof(glm::vec2), orbitData.data(), GL_DYNAMIC_DRAW);
+                }
+                shaderPert.setInt("orbitLen", (int)orbitData.size());
+                shaderPert.setVec2("refOffset", refOffset);
+                shaderPert.setBool("refine", pass > 0);
+                GLuint zero = 0;
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, glitchSSBO);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+                if (pass > 0) {
+                    // same geometry as pass 0, only the glitched pixels get past the discard in the shader
+                    glCopyImageSubData(targets.colorTex, GL_TEXTURE_2D, 0, 0, 0, 0, targets.glitchTex, GL_TEXTURE_2D, 0, 0, 0, 0, fbX, fbY, 1);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, targets.glitchTex);
+                }
+                drawCube(shaderPert);
+                // no pass is left to use another reference
+                if (pass == maxGlitchPasses) break;
+
+                glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+                GLuint glitches[4];
+                glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glitches), glitches);
+                if (glitches[0] == 0) break;
+                // glitchPos sits at offset 8 (std430 aligns vec2 to 8 bytes)
+                float glitchPos[2];
+                memcpy(glitchPos, &glitches[2], sizeof(glitchPos));
+                refOffset = glm::vec2(glitchPos[0], glitchPos[1]);
+            }
+            glDepthFunc(GL_LESS);
+        }
+        else if (itersPath) {
+            recoloured = true;
+            // the view of a pan in exploration mode moves by whole pixels (the front face is parallel to the
+            // screen there), so the buffer of the last frame lines up with this one shifted
+            glm::dvec2 itersPos = pos;
+            if (navigationReuse && explorationMode && !jittered) {
+                glm::dvec2 pitch = zoom*pixelPitch(matrix, fbX, fbY);
+                if (pitch.x > 0.0 && pitch.y > 0.0 && std::isfinite(pitch.x) && std::isfinite(pitch.y)) {
+                    itersPos = glm::round(pos/pitch)*pitch;
+                }
+            }
+            CubeInputs inputs = {matrix, effect, zoom, itersPos, fbX, fbY};
+            bool fresh = !(inputs == lastCube) || previewed;
+            // a lower maxIters is only a recolour, a higher one continues the pixels still bounded
+            if (fresh || frameIters > itersDone) {
+                glBindFramebuffer(GL_FRAMEBUFFER, targets.itersFbo);
+                glEnable(GL_DEPTH_TEST);
+                shader32Iters.use();
+                shader32Iters.setFloat("zoom", (float)zoom);
+                shader32Iters.setVec2("pos", glm::vec2(itersPos));
+                shader32Iters.setInt("maxIters", frameIters);
+                shader32Iters.setBool("countIters", benchmark);
+                shader32Iters.setMat4("mat", matrix);
+                shader32Iters.setMat4("effectMat", effect);
+                glBindImageTexture(0, targets.stateTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+                glBindVertexArray(cubeVAO);
+                // the buffer still holds the last view, reprojected into this one to reuse what stayed in place
+                // (not for refinement samples, whose sub-pixel offsets are the point)
+                bool reproject = fresh && reprojection && !jittered && lastCube.zoom > 0.0;
+                // a scroll step only resamples the last buffer, the frame after it iterates what did not line up
+                bool preview = reproject && navigationReuse && explorationMode && input.scroll != 0.0 && zoom != lastCube.zoom;
+                shader32Iters.setBool("reproject", reproject);
+                shader32Iters.setBool("preview", preview);
+                previewed = preview;
+                if (reproject) {
+                    glCopyImageSubData(targets.itersTex, GL_TEXTURE_2D, 0, 0, 0, 0, targets.prevItersTex, GL_TEXTURE_2D, 0, 0, 0, 0, lastCube.width, lastCube.height, 1);
+                    glCopyImageSubData(targets.cTex, GL_TEXTURE_2D, 0, 0, 0, 0, targets.prevCTex, GL_TEXTURE_2D, 0, 0, 0, 0, lastCube.width, lastCube.height, 1);
+                    glCopyImageSubData(targets.stateTex, GL_TEXTURE_2D, 0, 0, 0, 0, targets.prevStateTex, GL_TEXTURE_2D, 0, 0, 0, 0, lastCube.width, lastCube.height, 1);
+                    shader32Iters.setMat4("prevMat", lastCube.mat);
+                    shader32Iters.setMat4("prevEffect", lastCube.effect);
+                    shader32Iters.setFloat("prevScale", (float)(zoom/lastCube.zoom));
+                    shader32Iters.setVec2("prevShift", glm::vec2((itersPos - lastCube.pos)/lastCube.zoom));
+                    shader32Iters.setVec2("prevSize", glm::vec2(lastCube.width, lastCube.height));
+                    shader32Iters.setInt("prevMaxIters", itersDone);
+                    shader32Iters.setFloat("reuseTolerance", reuseTolerance);
+                    // units 0-2 stay with the screen pass
+                    glActiveTexture(GL_TEXTURE3);
+                    glBindTexture(GL_TEXTURE_2D, targets.prevItersTex);
+                    shader32Iters.setInt("prevIters", 3);
+                    glActiveTexture(GL_TEXTURE4);
+                    glBindTexture(GL_TEXTURE_2D, targets.prevCTex);
+                    shader32Iters.setInt("prevC", 4);
+                    // unit 8, 5-7 are the visibility buffer's and the face textures'
+                    glActiveTexture(GL_TEXTURE8);
+                    glBindTexture(GL_TEXTURE_2D, targets.prevStateTex);
+                    shader32Iters.setInt("prevState", 8);
+                    glActiveTexture(GL_TEXTURE0);
+                }
+                if (fresh) {
+                    lastCube = inputs;
+                    GLuint cleared[4] = {0xFFFFFFFFu, 0, 0, 0};
+                    glClearBufferuiv(GL_COLOR, 0, cleared);
+                    GLfloat clearedC[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                    glClearBufferfv(GL_COLOR, 1, clearedC);
+                    glClear(GL_DEPTH_BUFFER_BIT);
+                    // depth first, so the state of hidden faces is never written
+                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    shader32Iters.setBool("depthOnly", true);
+                    glDrawArrays(GL_TRIANGLES, 0, 36);
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                }
+                shader32Iters.setBool("depthOnly", false);
+                shader32Iters.setBool("resume", !fresh);
+                glDepthFunc(GL_LEQUAL);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glDepthFunc(GL_LESS);
+                // the state is also copied for the next frame's reprojection
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+                itersDone = frameIters;
+            }
+            else rendered = false;
+            if (colour1 != paletteC1 || colour2 != paletteC2 || banding != paletteBanding) {
+                paletteC1 = colour1;
+                paletteC2 = colour2;
+                paletteBanding = banding;
+                int size = std::max(banding, 1);
+                std::vector<glm::vec3> palette(size);
+                for (int i=0; i<size; i++) palette[i] = bandColour(i, -1, size, colour1, colour2);
+                glBindTexture(GL_TEXTURE_1D, paletteTex);
+                glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, size, 0, GL_RGB, GL_FLOAT, palette.data());
+            }
+        }
+        else if (dfPath) {
+            Shader &shaderDF = visible ? shaderDFVis : shaderDFCube;
+            shaderDF.use();
+            shaderDF.setVec2("posX", splitDouble(pos.x));
+            shaderDF.setVec2("posY", splitDouble(pos.y));
+            shaderDF.setVec2("zoom", splitDouble(zoom));
+            shaderDF.setInt("maxIters", frameIters);
+            shaderDF.setBool("countIters", benchmark);
+            shaderDF.setMat4("mat", matrix);
+            shaderDF.setMat4("effectMat", effect);
+            shaderDF.setVec3("c1", colour1);
+            shaderDF.setVec3("c2", colour2);
+            shaderDF.setInt("banding", banding);
+            drawAdaptive(shaderDF);
+        }
+        else if (faced) {
+            FacePlane planes[6];
+            bool shown[6];
+            for (int face=0; face<6; face++) {
+                shown[face] = FaceTextures::facing(matrix, face);
+                if (!shown[face]) continue;
+                planes[face] = facePlane(face, effect, zoom, pos);
+                glm::ivec2 size = FaceTextures::textureSize(matrix, face, scrX, scrY, maxFaceSize);
+                faces.allocate(face, size);
+                FaceInputs inputs = {planes[face], size, frameIters, colour1, colour2, banding};
+                if (inputs == faces.last[face]) continue;
+                faces.last[face] = inputs;
+                faces.bind(face);
+                glDisable(GL_DEPTH_TEST);
+                faceShader.use();
+                faceShader.setVec2("origin", glm::vec2(planes[face].origin));
+                faceShader.setVec2("du", glm::vec2(planes[face].du));
+                faceShader.setVec2("dv", glm::vec2(planes[face].dv));
+                faceShader.setInt("maxIters", frameIters);
+                faceShader.setBool("countIters", benchmark);
+                faceShader.setVec3("c1", colour1);
+                faceShader.setVec3("c2", colour2);
+                faceShader.setInt("banding", banding);
+                faceShader.setInt("subSamples", 0);
+                faceShader.setBool("resolve", false);
+                glBindVertexArray(rectVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glBindTexture(GL_TEXTURE_2D, faces.tex[face]);
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.fbo);
+            glViewport(0, 0, fbX, fbY);
+            glEnable(GL_DEPTH_TEST);
+            faceCubeShader.use();
+            faceCubeShader.setMat4("mat", matrix);
+            // unit 7, units 0-6 belong to the other passes
+            faceCubeShader.setInt("faceTex", 7);
+            glActiveTexture(GL_TEXTURE7);
+            glBindVertexArray(cubeVAO);
+            for (int face=0; face<6; face++) {
+                if (!shown[face]) continue;
+                glBindTexture(GL_TEXTURE_2D, faces.tex[face]);
+                glDrawArrays(GL_TRIANGLES, face*6, 6);
+            }
+            glActiveTexture(GL_TEXTURE0);
+        }
+        else if (computed) {
+            GLuint zero = 0;
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileQueueSSBO);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, tileQueueSSBO);
+            Shader &computeShader = bucketed ? bucketShader : tileShader;
+            computeShader.use();
+            computeShader.setFloat("zoom", (float)zoom);
+            computeShader.setVec2("pos", glm::vec2(pos));
+            computeShader.setInt("maxIters", frameIters);
+            computeShader.setBool("countIters", benchmark);
+            computeShader.setVec3("c1", colour1);
+            computeShader.setVec3("c2", colour2);
+            computeShader.setInt("banding", banding);
+            computeShader.setInt("visibility", 5);
+            computeShader.setVec2("size", glm::vec2(fbX, fbY));
+            glBindImageTexture(1, targets.colorTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            if (bucketed) {
+                // survivor lists of up to every pixel, read and written alternately
+                GLsizeiptr listSize = GLsizeiptr(fbX)*fbY*4*sizeof(GLuint);
+                if (listSize > survivorCapacity) {
+                    for (GLuint list : survivorSSBO) {
+                        glBindBuffer(GL_SHADER_STORAGE_BUFFER, list);
+                        glBufferData(GL_SHADER_STORAGE_BUFFER, listSize, nullptr, GL_DYNAMIC_COPY);
+                    }
+                    survivorCapacity = listSize;
+                }
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, survivorCountSSBO);
+                int start = 0;
+                int budget = bucketIters;
+                for (int pass=0; start < frameIters; pass++) {
+                    int end = (int)std::min((long long)start + budget, (long long)frameIters);
+                    int in = pass % 2, out = 1 - in;
+                    glBindBuffer(GL_SHADER_STORAGE_BUFFER, survivorCountSSBO);
+                    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, out*sizeof(GLuint), sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, survivorSSBO[in]);
+                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, survivorSSBO[out]);
+                    computeShader.setInt("start", start);
+                    computeShader.setInt("end", end);
+                    computeShader.setBool("firstPass", pass == 0);
+                    computeShader.setInt("countIn", in);
+                    computeShader.setInt("countOut", out);
+                    glDispatchCompute(computeGroups, 1, 1);
+                    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+                    start = end;
+                    budget = (int)std::min((long long)budget*4, (long long)INT_MAX/2);
+                }
+            }
+            else {
+                // more groups than tiles would only find the queue empty
+                int tiles = ((fbX+7)/8)*((fbY+7)/8);
+                glDispatchCompute(std::max(1, std::min(computeGroups, tiles)), 1, 1);
+            }
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        else {
+            Shader &shader32 = visible ? shader32Vis : shader32Cube;
             shader32.use();
             shader32.setFloat("zoom", (float)zoom);
             shader32.setVec2("pos", glm::vec2(pos));
-            shader32.setInt("maxIters", maxIters);
+            shader32.setInt("maxIters", frameIters);
+            shader32.setBool("countIters", benchmark);
             shader32.setMat4("mat", matrix);
             shader32.setMat4("effectMat", effect);
             shader32.setVec3("c1", colour1);
             shader32.setVec3("c2", colour2);
             shader32.setInt("banding", banding);
             //glBindTexture(GL_TEXTURE_2D, colorTex);
-            glBindVertexArray(cubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            drawAdaptive(shader32);
+        }
+
+        gpuTimer.end();
 
+        gpuTimer.begin("screen");
+        glDisable(GL_DEPTH_TEST);
+        screenShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, targets.colorTex);
+        screenShader.setInt("screenTex", 0);
+        // every sampler type needs its own unit, even when unused
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, targets.itersTex);
+        screenShader.setInt("itersTex", 1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_1D, paletteTex);
+        screenShader.setInt("palette", 2);
+        glActiveTexture(GL_TEXTURE0);
+        screenShader.setBool("recolour", recoloured);
+        screenShader.setVec2("renderSize", glm::vec2(fbX, fbY));
+        screenShader.setVec2("screenSize", glm::vec2(scrX, scrY));
+        screenShader.setInt("maxIters", frameIters);
+        screenShader.setVec3("interior", colour2);
+        screenShader.setBool("smoothColour", smoothColour);
+        screenShader.setFloat("paletteOffset", paletteOffset);
+        screenShader.setFloat("weight", 1.0f);
+        glBindVertexArray(rectVAO);
+        glViewport(0, 0, scrX, scrY);
+        if (refining) {
+            // resolved frame added onto the accumulation buffer, which is then shown divided by its count
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.accumFbo);
+            if (!converged) {
+                if (sample <= 0) glClear(GL_COLOR_BUFFER_BIT);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+                glDisable(GL_BLEND);
+            }
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
-            glViewport(0, 0, scrX, scrY);
-            glDisable(GL_DEPTH_TEST);
             glClear(GL_COLOR_BUFFER_BIT);
-            screenShader.use();
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, colorTex);
-            screenShader.setInt("screenTex", 0);
-            glBindVertexArray(rectVAO);
+            glBindTexture(GL_TEXTURE_2D, targets.accumTex);
+            screenShader.setBool("recolour", false);
+            screenShader.setVec2("renderSize", glm::vec2(scrX, scrY));
+            screenShader.setFloat("weight", 1.0f/float(std::min(std::max(sample, 0), samples-1) + 1));
             glDrawArrays(GL_TRIANGLES, 0, 6);
         }
-        else if (bits == 64) {
-            shader64.use();
-            shader64.setDouble("ratio", double(scrX)/double(scrY));
-            shader64.setFloat("zoom", zoom);
-            shader64.setVec2("pos", pos);
-            shader64.setInt("maxIters", maxIters);
-            glBindVertexArray(cubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        else {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
         }
+        gpuTimer.end();
+        if (governed) governor.endFrame(rendered && !pinned);
 
         glfwSwapBuffers(window);
+        if (benchmark) {
+            glFinish();
+            stats.frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            stats.pixels += double(fbX)*fbY;
+            GLuint count[2];
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, iterationSSBO);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(count), count);
+            glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            stats.iterations += (uint64_t(count[1]) << 32) | count[0];
+            if (frame+1 >= benchmarkFrames) glfwSetWindowShouldClose(window, true);
+        }
+        frame++;
+        if (fpsCap > 0.0f && !benchmark) {
+            std::this_thread::sleep_until(frameStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0/fpsCap)));
+        }
         glfwPollEvents();
         }
+    if (benchmark) {
+        std::string json = stats.json(fbX, fbY, ssaa, maxIters);
+        if (benchmarkJson.empty()) std::cout << json;
+        else {
+            std::ofstream file(benchmarkJson);
+            file << json;
+            if (!file) std::cout << "Could not write " << benchmarkJson << "\n";
+        }
+    }
+    if (!recordPath.empty() && !inputLog.save(recordPath)) {
+        std::cout << "Could not write " << recordPath << "\n";
+    }
+    gpuTimer.close();
     glDeleteVertexArrays(1, &rectVAO);
     glDeleteBuffers(1, &rectVBO);
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteBuffers(1, &cubeVBO);
-    shader64.del();
+    glDeleteBuffers(1, &orbitSSBO);
+    glDeleteBuffers(1, &glitchSSBO);
+    glDeleteBuffers(1, &iterationSSBO);
+    glDeleteBuffers(1, &tileQueueSSBO);
+    glDeleteBuffers(2, survivorSSBO);
+    glDeleteBuffers(1, &survivorCountSSBO);
+    glDeleteTextures(1, &paletteTex);
+    targets.release();
+    faces.release();
+    atlas.release();
+    governor.release();
+    shaderPertCube.del();
+    shaderDFCube.del();
+    shader32Iters.del();
+    visShader.del();
+    shader32Vis.del();
+    shaderDFVis.del();
+    shaderPertVis.del();
+    tileShader.del();
+    bucketShader.del();
+    faceShader.del();
+    faceCubeShader.del();
+    atlasShader.del();
 
     glfwTerminate();
     return 0;
@@ -349,64 +1065,96 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
+// reads the keys into input unless it is replayed, then applies it
+void processInput(GLFWwindow *window, InputFrame &input, bool replaying) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
+    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
+        std::cout << "(" << pos.x << ", " << pos.y << ")\n";
+    }
+    if (!replaying) {
+        const int keys[][2] = {
+            {GLFW_KEY_UP, INPUT_UP}, {GLFW_KEY_DOWN, INPUT_DOWN},
+            {GLFW_KEY_W, INPUT_W}, {GLFW_KEY_S, INPUT_S}, {GLFW_KEY_D, INPUT_D}, {GLFW_KEY_A, INPUT_A},
+            {GLFW_KEY_ENTER, INPUT_ENTER}, {GLFW_KEY_PAGE_UP, INPUT_PAGE_UP}, {GLFW_KEY_PAGE_DOWN, INPUT_PAGE_DOWN}
+        };
+        input.keys = 0;
+        for (const auto &key : keys) {
+            if (glfwGetKey(window, key[0]) == GLFW_PRESS) input.keys |= key[1];
+        }
+        input.scroll = pendingScroll;
+        pendingScroll = 0.0;
+    }
     double dDt = double(dt);
     double z = zoom;
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
+    if (input.keys & INPUT_UP) {
         maxIters += 1;
         if (maxIters < 0) {maxIters = 0;}
     }
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
+    if (input.keys & INPUT_DOWN) {
         maxIters -= 1;
         if (maxIters < 0) {maxIters = 0;}
     }
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.keys & INPUT_W) {
         pos.y += z*dDt;
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.keys & INPUT_S) {
         pos.y -= z*dDt;
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.keys & INPUT_D) {
         pos.x += z*dDt;
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.keys & INPUT_A) {
         pos.x -= z*dDt;
     }
-    if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) {
-        std::cout << "(" << pos.x << ", " << pos.y << ")\n";
-    }
-    if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
+    if (input.keys & INPUT_ENTER) {
         shotTime = t;
     }
-    if (glfwGetKey(window, GLFW_KEY_PAGE_UP) == GLFW_PRESS) {
+    if (input.keys & INPUT_PAGE_UP) {
         explorationMode = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) {
+    if (input.keys & INPUT_PAGE_DOWN) {
         explorationMode = false;
     }
+    scrollVal -= input.scroll;
 }
 
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    scrollVal -= yoffset;
+void refresh_callback(GLFWwindow*) {
+    windowDamaged = true;
 }
 
-
-glm::vec2 lerpVec2(glm::vec2 v1, glm::vec2 v2, float t) {
-    glm::vec2 r;
-
-    r.x = v1.x + t*(v2.x-v1.x);
-    r.y = v1.y + t*(v2.y-v1.y);
-
-    return r;
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    // applied in processInput so it can be recorded with the frame
+    pendingScroll += yoffset;
 }
 
-float lerpFloat(float a, float b, float t) {
-    float r;
+// double as a float pair hi + lo for the double-float kernel
+glm::vec2 splitDouble(double v) {
+    float hi = (float)v;
+    return glm::vec2(hi, (float)(v - hi));
+}
 
-    r = a + t*(b-a);
+// c per render target pixel along x and y at zoom 1 on the face of the cube facing the camera in
+// exploration mode, which lies parallel to the screen so a pixel is the same size everywhere on it
+glm::dvec2 pixelPitch(const glm::mat4 &mat, int width, int height) {
+    glm::vec4 o = mat*glm::vec4(0.0f, 0.0f, 0.5f, 1.0f);
+    glm::vec4 x = mat*glm::vec4(0.5f, 0.0f, 0.5f, 1.0f);
+    glm::vec4 y = mat*glm::vec4(0.0f, 0.5f, 0.5f, 1.0f);
+    // NDC spans 2, so a unit of the face covers the NDC distance of half a unit times the size in pixels
+    double px = std::abs(x.x/x.w - o.x/o.w)*width;
+    double py = std::abs(y.y/y.w - o.y/o.w)*height;
+    return glm::dvec2(1.0/px, 1.0/py);
+}
 
+// radical inverse of index in base, a low discrepancy sequence in [0, 1) for sample offsets
+float halton(int index, int base) {
+    float f = 1.0f;
+    float r = 0.0f;
+    while (index > 0) {
+        f /= base;
+        r += f*(index % base);
+        index /= base;
+    }
     return r;
 }
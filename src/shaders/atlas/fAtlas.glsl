@@ -0,0 +1,43 @@
+#version 460 core
+// shot atlas playback (shotAtlas.h): colours come from iteration counts computed before the shot played,
+// drawn with vVis.glsl for the unit offset of c
+out vec4 FragColour;
+in vec2 unit;
+
+// level of the pyramid for this frame's zoom; its grid coordinate is atlasOffset + atlasScale*unit,
+// (pos - origin)/extent and zoom/extent worked out in double on the cpu
+uniform usampler2D atlas;
+uniform vec2 atlasOffset;
+uniform vec2 atlasScale;
+
+uniform int maxIters;
+uniform vec3 c1;
+uniform vec3 c2;
+uniform int banding;
+
+vec3 colourOf(int iters) {
+	float t;
+	if (iters == maxIters-1.0f) t = 1.0f;
+	else t = float(iters % banding)/float(banding);
+	float r = c1.x + t*(c2.x-c1.x);
+	float g = c1.y + t*(c2.y-c1.y);
+	float b = c1.z + t*(c2.z-c1.z);
+	return vec3(r, g, b);
+}
+
+void main() {
+	ivec2 size = textureSize(atlas, 0);
+	// colours of the four texels around c blended bilinearly, counts themselves do not interpolate
+	vec2 f = (atlasOffset + atlasScale*unit)*vec2(size) - 0.5f;
+	ivec2 i0 = ivec2(floor(f));
+	vec2 w = f - vec2(i0);
+	vec3 colour = vec3(0.0f);
+	for (int j=0; j<2; j++) {
+		for (int i=0; i<2; i++) {
+			ivec2 t = clamp(i0 + ivec2(i, j), ivec2(0), size - 1);
+			float weight = (i == 0 ? 1.0f - w.x : w.x)*(j == 0 ? 1.0f - w.y : w.y);
+			colour += weight*colourOf(int(texelFetch(atlas, t, 0).r));
+		}
+	}
+	FragColour = vec4(colour, 1.0f);
+}
@@ -0,0 +1,131 @@
+#version 460 core
+// iteration-bucketed version of cEscape.glsl: each pass iterates its pixels from iteration start up to
+// end and appends the ones still bounded, with their z, to a list the next pass runs on. The first pass
+// covers every pixel of the visibility buffer with a small budget; later passes only see the survivors,
+// so the few slow pixels no longer keep whole groups of fast ones waiting in lockstep.
+layout(local_size_x = 64) in;
+
+layout(binding=1, rgba16f) uniform writeonly image2D colourOut;
+uniform sampler2D visibility;
+uniform vec2 size;      // pixels rendered (the bottom left part of the targets)
+
+uniform float zoom;
+uniform vec2 pos;
+uniform int maxIters;
+uniform vec3 c1;
+uniform vec3 c2;
+uniform int banding;
+
+// iterations run by this pass
+uniform int start;
+uniform int end;
+// pass 0 reads the visibility buffer instead of a survivor list
+uniform bool firstPass;
+// which count of SurvivorCount belongs to the list read and the list written
+uniform int countIn;
+uniform int countOut;
+
+struct Survivor {
+	vec2 z;
+	uint pixel;     // x | y << 16
+	uint pad;
+};
+
+layout(std430, binding=4) buffer SurvivorCount {
+	uint counts[2];
+};
+layout(std430, binding=5) readonly buffer SurvivorsIn {
+	Survivor survivorsIn[];
+};
+layout(std430, binding=6) writeonly buffer SurvivorsOut {
+	Survivor survivorsOut[];
+};
+
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+// main cardioid and period-2 bulb, points inside never escape
+bool inCardioidOrBulb(vec2 c) {
+	float x = c.x - 0.25f;
+	float q = x*x + c.y*c.y;
+	if (q*(q + x) <= 0.25f*c.y*c.y) return true;
+	return (c.x+1.0f)*(c.x+1.0f) + c.y*c.y <= 0.0625f;
+}
+
+vec3 colourOf(int iters) {
+	float t;
+	if (iters == maxIters-1.0f) t = 1.0f;
+	else t = float(iters % banding)/float(banding);
+	return c1 + t*(c2-c1);
+}
+
+void run(ivec2 p, vec2 z) {
+	vec2 c = pos + zoom*texelFetch(visibility, p, 0).xy;
+	if (firstPass && maxIters > 0 && inCardioidOrBulb(c)) {
+		imageStore(colourOut, p, vec4(colourOf(maxIters-1), 1.0f));
+		return;
+	}
+	// Brent cycle detection restarted every pass, an exact repeat proves a cycle wherever it starts
+	vec2 saved = z;
+	int period = 0;
+	int limit = 8;
+	int iters = max(start-1, 0);
+	int i = start;
+	bool escaped = false;
+	for (; i<end; i++) {
+		z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+		if (dot(z, z) > 4.0) {
+			escaped = true;
+			break;
+		}
+		iters = i;
+		if (z == saved) {
+			iters = maxIters-1;
+			escaped = true;
+			break;
+		}
+		if (++period == limit) {
+			period = 0;
+			limit *= 2;
+			saved = z;
+		}
+	}
+	countIterations(min(i+1, end) - start);
+	if (escaped || end >= maxIters) {
+		imageStore(colourOut, p, vec4(colourOf(escaped ? iters : maxIters-1), 1.0f));
+		return;
+	}
+	uint slot = atomicAdd(counts[countOut], 1u);
+	survivorsOut[slot] = Survivor(z, uint(p.x) | uint(p.y) << 16, 0u);
+}
+
+void main() {
+	// persistent invocations striding over the work, the dispatch size does not depend on the list
+	uint stride = gl_NumWorkGroups.x*gl_WorkGroupSize.x;
+	if (firstPass) {
+		ivec2 pixels = ivec2(size);
+		uint count = uint(pixels.x*pixels.y);
+		for (uint k=gl_GlobalInvocationID.x; k<count; k+=stride) {
+			ivec2 p = ivec2(int(k) % pixels.x, int(k) / pixels.x);
+			// pixels off the cube keep the clear colour
+			if (texelFetch(visibility, p, 0).z > 0.0f) run(p, vec2(0.0f));
+		}
+	}
+	else {
+		uint count = counts[countIn];
+		for (uint k=gl_GlobalInvocationID.x; k<count; k+=stride) {
+			Survivor s = survivorsIn[k];
+			run(ivec2(s.pixel & 0xffffu, s.pixel >> 16), s.z);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#version 460 core
+// plain float kernel of fShader32.glsl as a compute shader over the visibility buffer (fVis.glsl).
+// A fixed number of persistent workgroups each take the next tile from an atomic counter until none are
+// left, so cheap tiles never hold a unit back while an expensive one is still running elsewhere.
+// One invocation per pixel of a tileSize x tileSize tile.
+layout(local_size_x = 8, local_size_y = 8) in;
+const int tileSize = 8;
+
+layout(binding=1, rgba16f) uniform writeonly image2D colourOut;
+uniform sampler2D visibility;
+uniform vec2 size;      // pixels rendered (the bottom left part of the targets)
+
+uniform float zoom;
+uniform vec2 pos;
+uniform int maxIters;
+uniform vec3 c1;
+uniform vec3 c2;
+uniform int banding;
+
+// next tile to hand out, zeroed before every dispatch
+layout(std430, binding=3) buffer TileQueue {
+	uint nextTile;
+};
+
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+// main cardioid and period-2 bulb, points inside never escape
+bool inCardioidOrBulb(vec2 c) {
+	float x = c.x - 0.25f;
+	float q = x*x + c.y*c.y;
+	if (q*(q + x) <= 0.25f*c.y*c.y) return true;
+	return (c.x+1.0f)*(c.x+1.0f) + c.y*c.y <= 0.0625f;
+}
+
+int escape(vec2 c) {
+	vec2 z = vec2(0.0f, 0.0f);
+	int iters = 0;
+	if (maxIters > 0 && inCardioidOrBulb(c)) return maxIters-1;
+	// Brent cycle detection: an orbit that comes back to the saved point never escapes
+	vec2 saved = z;
+	int period = 0;
+	int limit = 8;
+	int i = 0;
+	for (; i<maxIters; i++) {
+		z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+		if (dot(z, z) > 4.0) {
+			break;
+		}
+		iters = i;
+		if (z == saved) {
+			iters = maxIters-1;
+			break;
+		}
+		if (++period == limit) {
+			period = 0;
+			limit *= 2;
+			saved = z;
+		}
+	}
+	countIterations(min(i+1, maxIters));
+	return iters;
+}
+
+vec3 colourOf(int iters) {
+	float t;
+	if (iters == maxIters-1.0f) t = 1.0f;
+	else t = float(iters % banding)/float(banding);
+	return c1 + t*(c2-c1);
+}
+
+shared uint tile;
+
+void main() {
+	ivec2 pixels = ivec2(size);
+	ivec2 tiles = (pixels + tileSize-1)/tileSize;
+	uint tileCount = uint(tiles.x*tiles.y);
+	for (;;) {
+		if (gl_LocalInvocationIndex == 0u) {
+			tile = atomicAdd(nextTile, 1u);
+		}
+		barrier();
+		uint t = tile;
+		// the same for the whole group, so every invocation leaves together
+		if (t >= tileCount) break;
+		ivec2 p = ivec2(int(t) % tiles.x, int(t) / tiles.x)*tileSize + ivec2(gl_LocalInvocationID.xy);
+		vec4 v = vec4(0.0f);
+		if (all(lessThan(p, pixels))) v = texelFetch(visibility, p, 0);
+		// pixels off the cube keep the clear colour, a tile with none on it is done at once
+		if (v.z > 0.0f) {
+			vec2 c = pos + zoom*v.xy;
+			imageStore(colourOut, p, vec4(colourOf(escape(c)), 1.0f));
+		}
+		// everyone has read tile before the next one is taken
+		barrier();
+	}
+}
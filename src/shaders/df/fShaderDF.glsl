@@ -0,0 +1,180 @@
+#version 460 core
+// the count pass of adaptive supersampling only stores the counts of fragments that stay on screen
+layout(early_fragment_tests) in;
+out vec4 FragColour;
+in vec2 unit;
+
+// double-float numbers: value = hi + lo as vec2(hi, lo), about 48 bits of mantissa on fp32 ALUs
+uniform vec2 posX;
+uniform vec2 posY;
+uniform vec2 zoom;
+uniform int maxIters;
+uniform vec3 c1;
+uniform vec3 c2;
+uniform int banding;
+// adaptive supersampling as in fShader32.glsl
+uniform int subSamples;
+uniform bool resample;
+layout(binding=2, r32i) uniform iimage2D counts;
+// visibility buffer pipeline: drawn as a full screen pass (vResolve.glsl) that reads unit from the
+// visibility buffer written by fVis.glsl, so the kernel runs once per covered pixel
+uniform bool resolve;
+uniform sampler2D visibility;
+uniform sampler2D visibilityDeriv;
+
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+// error-free transformations, "precise" keeps the compiler from reassociating or contracting them
+vec2 twoSum(float a, float b) {
+	precise float s = a + b;
+	precise float v = s - a;
+	precise float e = (a - (s - v)) + (b - v);
+	return vec2(s, e);
+}
+
+vec2 quickTwoSum(float a, float b) {
+	precise float s = a + b;
+	precise float e = b - (s - a);
+	return vec2(s, e);
+}
+
+vec2 twoProd(float a, float b) {
+	precise float p = a*b;
+	precise float e = fma(a, b, -p);
+	return vec2(p, e);
+}
+
+vec2 dfAdd(vec2 a, vec2 b) {
+	precise vec2 s = twoSum(a.x, b.x);
+	precise vec2 t = twoSum(a.y, b.y);
+	s.y += t.x;
+	s = quickTwoSum(s.x, s.y);
+	s.y += t.y;
+	return quickTwoSum(s.x, s.y);
+}
+
+vec2 dfSub(vec2 a, vec2 b) {
+	return dfAdd(a, -b);
+}
+
+vec2 dfMul(vec2 a, vec2 b) {
+	precise vec2 p = twoProd(a.x, b.x);
+	p.y += a.x*b.y + a.y*b.x;
+	return quickTwoSum(p.x, p.y);
+}
+
+// main cardioid and period-2 bulb, points inside never escape
+bool inCardioidOrBulb(vec2 cx, vec2 cy) {
+	vec2 x = dfSub(cx, vec2(0.25f, 0.0f));
+	vec2 y2 = dfMul(cy, cy);
+	vec2 q = dfAdd(dfMul(x, x), y2);
+	if (dfSub(dfMul(q, dfAdd(q, x)), 0.25f*y2).x <= 0.0f) return true;
+	vec2 x1 = dfAdd(cx, vec2(1.0f, 0.0f));
+	return dfAdd(dfMul(x1, x1), y2).x <= 0.0625f;
+}
+
+int escape(vec2 u) {
+	vec2 cx = dfAdd(posX, dfMul(zoom, vec2(u.x, 0.0f)));
+	vec2 cy = dfAdd(posY, dfMul(zoom, vec2(u.y, 0.0f)));
+	vec2 zx = vec2(0.0f, 0.0f);
+	vec2 zy = vec2(0.0f, 0.0f);
+	int iters = 0;
+	if (maxIters > 0 && inCardioidOrBulb(cx, cy)) return maxIters-1;
+	// Brent cycle detection: an orbit that comes back to the saved point never escapes
+	vec2 savedX = zx;
+	vec2 savedY = zy;
+	int period = 0;
+	int limit = 8;
+	int i = 0;
+	for (; i<maxIters; i++) {
+		vec2 x2 = dfMul(zx, zx);
+		vec2 y2 = dfMul(zy, zy);
+		vec2 xy = dfMul(zx, zy);
+		zx = dfAdd(dfSub(x2, y2), cx);
+		zy = dfAdd(2.0f*xy, cy);
+		if (zx.x*zx.x + zy.x*zy.x > 4.0) {
+			break;
+		}
+		iters = i;
+		if (zx == savedX && zy == savedY) {
+			iters = maxIters-1;
+			break;
+		}
+		if (++period == limit) {
+			period = 0;
+			limit *= 2;
+			savedX = zx;
+			savedY = zy;
+		}
+	}
+	countIterations(min(i+1, maxIters));
+	return iters;
+}
+
+vec3 colourOf(int iters) {
+	float t;
+	if (iters == maxIters-1.0f) t = 1.0f;
+	else t = float(iters % banding)/float(banding);
+	float r = c1.x + t*(c2.x-c1.x);
+	float g = c1.y + t*(c2.y-c1.y);
+	float b = c1.z + t*(c2.z-c1.z);
+	return vec3(r, g, b);
+}
+
+// true if a neighbour left, right, above or below has another count; pixels of nothing are -1 and left out
+bool nearEdge(ivec2 p) {
+	int n = imageLoad(counts, p).r;
+	ivec2 size = imageSize(counts);
+	const ivec2 offsets[4] = ivec2[4](ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1));
+	for (int k=0; k<4; k++) {
+		ivec2 q = p + offsets[k];
+		if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size))) continue;
+		int m = imageLoad(counts, q).r;
+		if (m >= 0 && m != n) return true;
+	}
+	return false;
+}
+
+void main() {
+	// sub-samples are offsets of unit, which is small enough for single precision steps
+	vec2 u = unit;
+	vec2 dx = dFdxFine(unit);
+	vec2 dy = dFdyFine(unit);
+	bool covered = true;
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	if (resolve) {
+		vec4 v = texelFetch(visibility, p, 0);
+		vec4 d = texelFetch(visibilityDeriv, p, 0);
+		covered = v.z > 0.0f;
+		u = v.xy;
+		dx = d.xy;
+		dy = d.zw;
+	}
+	if (resample) {
+		if (!covered || !nearEdge(p)) discard;
+		vec3 colour = vec3(0.0f);
+		for (int j=0; j<subSamples; j++) {
+			for (int i=0; i<subSamples; i++) {
+				vec2 o = (vec2(i, j) + 0.5f)/float(subSamples) - 0.5f;
+				colour += colourOf(escape(u + o.x*dx + o.y*dy));
+			}
+		}
+		FragColour = vec4(colour/float(subSamples*subSamples), 1.0f);
+		return;
+	}
+	int iters = covered ? escape(u) : 0;
+	if (subSamples > 1) imageStore(counts, p, ivec4(covered ? iters : -1));
+	vec3 colour = covered ? colourOf(iters) : vec3(0.0f);
+	FragColour = vec4(colour, 1.0f);
+}
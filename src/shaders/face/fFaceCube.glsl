@@ -0,0 +1,10 @@
+#version 460 core
+out vec4 FragColour;
+in vec2 uv;
+
+// texture of the face being drawn, filtered from its mipmaps
+uniform sampler2D faceTex;
+
+void main() {
+	FragColour = vec4(texture(faceTex, uv).rgb, 1.0f);
+}
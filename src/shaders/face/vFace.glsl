@@ -0,0 +1,15 @@
+#version 460 core
+// per face rendering: the quad covers a face texture and c is the face's plane at the texel
+// (facePlane in scene.h), the fragment shader is the usual fShader32.glsl
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec2 aUV;
+
+out vec4 FragPos;
+uniform vec2 origin;
+uniform vec2 du;
+uniform vec2 dv;
+
+void main() {
+	FragPos = vec4(origin + aUV.x*du + aUV.y*dv, 0.0f, 1.0f);
+	gl_Position = vec4(aPos, 1.0f);
+}
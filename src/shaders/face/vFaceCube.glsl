@@ -0,0 +1,11 @@
+#version 460 core
+layout (location=0) in vec3 aPos;
+layout (location=1) in vec2 aUV;
+
+out vec2 uv;
+uniform mat4 mat;
+
+void main() {
+	uv = aUV;
+	gl_Position = mat*vec4(aPos, 1.0f);
+}
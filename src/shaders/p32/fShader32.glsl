@@ -1,4 +1,6 @@
 #version 460 core
+// the count pass of adaptive supersampling only stores the counts of fragments that stay on screen
+layout(early_fragment_tests) in;
 out vec4 FragColour;
 in  vec4 FragPos;
 
@@ -6,23 +8,124 @@ uniform int maxIters;
 uniform vec3 c1;
 uniform vec3 c2;
 uniform int banding;
+// adaptive supersampling, two passes over the same pixels: the first takes one sample and stores its count
+// in counts, the second (resample) takes subSamples x subSamples points across the pixels whose count differs
+// from one of their four neighbours and discards the rest; 0 or 1 takes one sample everywhere
+uniform int subSamples;
+uniform bool resample;
+layout(binding=2, r32i) uniform iimage2D counts;
+// visibility buffer pipeline: drawn as a full screen pass (vResolve.glsl) that reads c from the
+// visibility buffer written by fVis.glsl, so the kernel runs once per covered pixel
+uniform bool resolve;
+uniform sampler2D visibility;
+uniform sampler2D visibilityDeriv;
+// vertex stage uniforms, c = pos + zoom*unit in resolve passes
+uniform float zoom;
+uniform vec2 pos;
 
-void main() {
-	vec2 c = FragPos.xy;
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+// main cardioid and period-2 bulb, points inside never escape
+bool inCardioidOrBulb(vec2 c) {
+	float x = c.x - 0.25f;
+	float q = x*x + c.y*c.y;
+	if (q*(q + x) <= 0.25f*c.y*c.y) return true;
+	return (c.x+1.0f)*(c.x+1.0f) + c.y*c.y <= 0.0625f;
+}
+
+int escape(vec2 c) {
 	vec2 z = vec2(0.0f, 0.0f);
 	int iters = 0;
-	for (int i=0; i<maxIters; i++) {
+	if (maxIters > 0 && inCardioidOrBulb(c)) return maxIters-1;
+	// Brent cycle detection: an orbit that comes back to the saved point never escapes
+	vec2 saved = z;
+	int period = 0;
+	int limit = 8;
+	int i = 0;
+	for (; i<maxIters; i++) {
 		z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
 		if (dot(z, z) > 4.0) {
 			break;
 		}
 		iters = i;
+		if (z == saved) {
+			iters = maxIters-1;
+			break;
+		}
+		if (++period == limit) {
+			period = 0;
+			limit *= 2;
+			saved = z;
+		}
 	}
+	countIterations(min(i+1, maxIters));
+	return iters;
+}
+
+vec3 colourOf(int iters) {
 	float t;
 	if (iters == maxIters-1.0f) t = 1.0f;
 	else t = float(iters % banding)/float(banding);
 	float r = c1.x + t*(c2.x-c1.x);
 	float g = c1.y + t*(c2.y-c1.y);
 	float b = c1.z + t*(c2.z-c1.z);
-	FragColour = vec4(r, g, b, 1.0f);
-}
\ No newline at end of file
+	return vec3(r, g, b);
+}
+
+// true if a neighbour left, right, above or below has another count; pixels of nothing are -1 and left out
+bool nearEdge(ivec2 p) {
+	int n = imageLoad(counts, p).r;
+	ivec2 size = imageSize(counts);
+	const ivec2 offsets[4] = ivec2[4](ivec2(1, 0), ivec2(-1, 0), ivec2(0, 1), ivec2(0, -1));
+	for (int k=0; k<4; k++) {
+		ivec2 q = p + offsets[k];
+		if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, size))) continue;
+		int m = imageLoad(counts, q).r;
+		if (m >= 0 && m != n) return true;
+	}
+	return false;
+}
+
+void main() {
+	vec2 c = FragPos.xy;
+	// derivatives before any branching, the whole quad has to reach them
+	vec2 dx = dFdxFine(c);
+	vec2 dy = dFdyFine(c);
+	bool covered = true;
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	if (resolve) {
+		vec4 v = texelFetch(visibility, p, 0);
+		vec4 d = texelFetch(visibilityDeriv, p, 0);
+		covered = v.z > 0.0f;
+		c = pos + zoom*v.xy;
+		dx = zoom*d.xy;
+		dy = zoom*d.zw;
+	}
+	if (resample) {
+		if (!covered || !nearEdge(p)) discard;
+		vec3 colour = vec3(0.0f);
+		for (int j=0; j<subSamples; j++) {
+			for (int i=0; i<subSamples; i++) {
+				vec2 o = (vec2(i, j) + 0.5f)/float(subSamples) - 0.5f;
+				colour += colourOf(escape(c + o.x*dx + o.y*dy));
+			}
+		}
+		FragColour = vec4(colour/float(subSamples*subSamples), 1.0f);
+		return;
+	}
+	int iters = covered ? escape(c) : 0;
+	if (subSamples > 1) imageStore(counts, p, ivec4(covered ? iters : -1));
+	vec3 colour = covered ? colourOf(iters) : vec3(0.0f);
+	FragColour = vec4(colour, 1.0f);
+}
@@ -0,0 +1,192 @@
+#version 460 core
+// same escape loop as fShader32.glsl, but writes the iteration count for the recolour pass in fScreen.glsl
+// and keeps each pixel's z so a later pass with a higher maxIters continues where this one stopped
+layout(early_fragment_tests) in;
+layout(location=0) out uint FragIters;
+// the c the count belongs to, for reprojection by the next frame
+layout(location=1) out vec2 FragC;
+in  vec4 FragPos;
+in  vec3 CubePos;
+
+// z, iterations done and status (0 still bounded, 1 escaped, 2 proven interior) of every pixel
+layout(binding=0, rgba32f) uniform image2D state;
+
+uniform int maxIters;
+// depth only pass so the shading passes run just once per visible pixel
+uniform bool depthOnly;
+// continue the bounded pixels from state instead of starting at z = 0
+uniform bool resume;
+
+// temporal reprojection: a fresh pass first looks where this c was on the cube in the previous frame
+// and takes the count of a nearby pixel whose c is within reuseTolerance pixels of this one
+uniform bool reproject;
+uniform mat4 prevMat;
+uniform mat4 prevEffect;
+uniform vec2 prevSize;
+uniform int prevMaxIters;
+uniform usampler2D prevIters;
+uniform sampler2D prevC;
+uniform sampler2D prevState;
+uniform float reuseTolerance;
+// the previous frame's unit offset of c is unit*prevScale + prevShift (pans and zooms)
+uniform float prevScale;
+uniform vec2 prevShift;
+// zoom preview: every pixel takes the nearest previous count whatever its c, nothing is iterated
+// unless the previous frame did not cover it
+uniform bool preview;
+// vertex stage uniform, for the unit offset of c
+uniform mat4 effectMat;
+
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+// main cardioid and period-2 bulb, points inside never escape
+bool inCardioidOrBulb(vec2 c) {
+	float x = c.x - 0.25f;
+	float q = x*x + c.y*c.y;
+	if (q*(q + x) <= 0.25f*c.y*c.y) return true;
+	return (c.x+1.0f)*(c.x+1.0f) + c.y*c.y <= 0.0625f;
+}
+
+// interior points are stored with this count, so they stay interior for any maxIters
+const int interiorIters = 0xffffff;
+
+// point of this face that had this c in the previous frame: CubePos moved along the face so that
+// prevEffect maps it to the previous unit offset of c
+vec3 previousPoint() {
+	vec3 a = abs(CubePos);
+	int axis = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+	vec3 t1 = vec3(0.0f);
+	vec3 t2 = vec3(0.0f);
+	t1[(axis+1)%3] = 1.0f;
+	t2[(axis+2)%3] = 1.0f;
+	vec2 unit = (effectMat*vec4(CubePos, 1.0f)).xy;
+	vec2 target = unit*prevScale + prevShift;
+	mat2 m = mat2((prevEffect*vec4(t1, 0.0f)).xy, (prevEffect*vec4(t2, 0.0f)).xy);
+	// the face is edge on in the plane, c does not pin down a point on it
+	if (abs(determinant(m)) < 1e-6f) return CubePos;
+	vec2 st = inverse(m)*(target - (prevEffect*vec4(CubePos, 1.0f)).xy);
+	return CubePos + st.x*t1 + st.y*t2;
+}
+
+// previous frame's count for c, or 0xFFFFFFFF if none is close enough (any in preview mode), with the
+// c and texel it came from
+uint reprojected(vec2 c, float pixel, out vec2 prevCOut, out ivec2 prevTexel) {
+	vec4 clip = prevMat*vec4(previousPoint(), 1.0f);
+	if (clip.w <= 0.0f) return 0xFFFFFFFFu;
+	ivec2 q = ivec2(floor((clip.xy/clip.w*0.5f + 0.5f)*prevSize));
+	uint best = 0xFFFFFFFFu;
+	float bestDist = preview ? 1e30f : reuseTolerance*pixel;
+	for (int j=-1; j<=1; j++) {
+		for (int i=-1; i<=1; i++) {
+			ivec2 t = q + ivec2(i, j);
+			if (any(lessThan(t, ivec2(0))) || any(greaterThanEqual(t, ivec2(prevSize)))) continue;
+			uint v = texelFetch(prevIters, t, 0).r;
+			if (v == 0xFFFFFFFFu) continue;
+			vec2 pc = texelFetch(prevC, t, 0).xy;
+			float d = distance(pc, c);
+			if (d <= bestDist) {
+				bestDist = d;
+				best = v;
+				prevCOut = pc;
+				prevTexel = t;
+			}
+		}
+	}
+	return best;
+}
+
+void main() {
+	if (depthOnly) return;
+	ivec2 p = ivec2(gl_FragCoord.xy);
+	vec2 c = FragPos.xy;
+	// size of a pixel in c, taken before any branching
+	float pixel = length(fwidth(c));
+	vec2 z = vec2(0.0f, 0.0f);
+	int start = 0;
+	int iters = 0;
+	float status = 0.0f;
+	float frac = 0.0f;
+	// continuing an orbit, from this pixel's state or a reprojected one
+	bool resumed = resume;
+	if (reproject && !resume) {
+		vec2 pc;
+		ivec2 pt;
+		uint v = reprojected(c, pixel, pc, pt);
+		if (v != 0xFFFFFFFFu) {
+			int n = int(v >> 8);
+			vec4 s = texelFetch(prevState, pt, 0);
+			// escaped counts are final; the state only needs the status and, for escaped, when it escaped
+			if (n == interiorIters) imageStore(state, p, vec4(0.0f, 0.0f, float(max(prevMaxIters, maxIters)), 2.0f));
+			else if (s.w != 0.0f) imageStore(state, p, vec4(0.0f, 0.0f, float(n+2), 1.0f));
+			else if (preview) imageStore(state, p, s);
+			if (n == interiorIters || s.w != 0.0f || preview) {
+				FragIters = v;
+				FragC = pc;
+				return;
+			}
+			// still bounded when the previous frame stopped, its orbit goes on from the stored z
+			c = pc;
+			z = s.xy;
+			start = int(s.z);
+			iters = start-1;
+			resumed = true;
+		}
+	}
+	if (resume) {
+		vec4 s = imageLoad(state, p);
+		// escaped or interior, the count from the earlier pass is final
+		if (s.w != 0.0f) discard;
+		z = s.xy;
+		start = int(s.z);
+		iters = start-1;
+	}
+	int done = max(start, maxIters);
+	if (!resumed && maxIters > 0 && inCardioidOrBulb(c)) {
+		iters = interiorIters;
+		status = 2.0f;
+	}
+	else {
+		// Brent cycle detection: an orbit that comes back to the saved point never escapes
+		vec2 saved = z;
+		int period = 0;
+		int limit = 8;
+		int i = start;
+		for (; i<maxIters; i++) {
+			z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+			if (dot(z, z) > 4.0) {
+				// fraction of the smooth (continuous) iteration count, |z|^2 in (4, 16] maps to [0, 1)
+				frac = clamp(1.0f - log2(0.5f*log2(dot(z, z))), 0.0f, 1.0f);
+				status = 1.0f;
+				done = i+1;
+				break;
+			}
+			iters = i;
+			if (z == saved) {
+				iters = interiorIters;
+				status = 2.0f;
+				break;
+			}
+			if (++period == limit) {
+				period = 0;
+				limit *= 2;
+				saved = z;
+			}
+		}
+		countIterations(min(i+1, maxIters) - start);
+	}
+	imageStore(state, p, vec4(z, float(done), status));
+	FragC = c;
+	// count in the top 24 bits, fraction in the low 8
+	FragIters = (uint(iters) << 8) | uint(frac*255.0f);
+}
\ No newline at end of file
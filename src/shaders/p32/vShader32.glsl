@@ -2,6 +2,8 @@
 layout (location=0) in vec3 aPos;
 
 out vec4 FragPos;
+// point on the cube, for reprojecting into the previous frame (fShader32Iters.glsl)
+out vec3 CubePos;
 uniform float zoom;
 uniform vec2 pos;
 uniform mat4 mat;
@@ -10,5 +12,6 @@ uniform mat4 effectMat;
 void main() {
 	//FragPos = vec4(aPos, 1.0f)*zoom*effectMat+vec4(pos, 0.0f, 1.0f);
 	FragPos = zoom*effectMat*vec4(aPos, 1.0f) + vec4(pos, 0.0f, 1.0f);
+	CubePos = aPos;
 	gl_Position = mat*vec4(aPos, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#version 460 core
+layout(early_fragment_tests) in;
+out vec4 FragColour;
+in vec2 dcUnit;
+in vec2 posUnit;
+
+// reference orbit Z_0 = 0, Z_1, ... up to maxIters or its escape
+layout(std430, binding=0) readonly buffer RefOrbit {
+	vec2 orbit[];
+};
+// number of glitched pixels and where one of them is, to place the next reference
+layout(std430, binding=1) buffer Glitches {
+	uint glitchCount;
+	vec2 glitchPos;
+};
+
+uniform int orbitLen;
+uniform int zoomExp;
+uniform int maxIters;
+uniform vec3 c1;
+uniform vec3 c2;
+uniform int banding;
+// depth only pass, so glitches are only counted for the fragments that end up on screen
+uniform bool depthOnly;
+// extra passes only redo pixels the previous pass flagged (alpha 0)
+uniform bool refine;
+uniform sampler2D prevPass;
+// visibility buffer pipeline: drawn as a full screen pass (vResolve.glsl) that reads the pixel offset from the
+// visibility buffer written by fVis.glsl, so the kernel runs once per covered pixel
+uniform bool resolve;
+uniform sampler2D visibility;
+uniform sampler2D visibilityDeriv;
+// vertex stage uniforms, the offsets are rebuilt from them in resolve passes
+uniform float zoomMantissa;
+uniform vec2 refOffset;
+
+// escape loop iterations, counted for the benchmark mode (64 bit as two uints)
+layout(std430, binding=2) buffer IterationCount {
+	uint itersLo;
+	uint itersHi;
+};
+uniform bool countIters;
+
+void countIterations(int n) {
+	if (!countIters || n <= 0) return;
+	uint old = atomicAdd(itersLo, uint(n));
+	if (old + uint(n) < old) atomicAdd(itersHi, 1u);
+}
+
+vec2 cmul(vec2 a, vec2 b) {
+	return vec2(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x);
+}
+
+void main() {
+	if (depthOnly) return;
+	if (refine && texelFetch(prevPass, ivec2(gl_FragCoord.xy), 0).a > 0.5f) discard;
+	vec2 pixelPos = posUnit;
+	vec2 pixelDc = dcUnit;
+	if (resolve) {
+		vec4 v = texelFetch(visibility, ivec2(gl_FragCoord.xy), 0);
+		// uncovered, the clear colour stays
+		if (v.z == 0.0f) discard;
+		pixelPos = zoomMantissa*v.xy;
+		pixelDc = pixelPos - refOffset;
+	}
+
+	// dz = w*2^s; while dz is below what floats hold w is kept near 1 and s tracks the scale
+	vec2 w = vec2(0.0f, 0.0f);
+	int s = zoomExp < -100 ? zoomExp : 0;
+	vec2 dc = ldexp(pixelDc, ivec2(zoomExp));
+	int iters = 0;
+	bool glitched = false;
+	int i = 0;
+	for (; i<maxIters; i++) {
+		if (i+1 >= orbitLen) {
+			// the reference escaped first, this pixel needs another one
+			glitched = true;
+			break;
+		}
+		vec2 Z = orbit[i];
+		vec2 z;
+		if (s < -100) {
+			w = 2.0f*cmul(Z, w) + ldexp(cmul(w, w), ivec2(s)) + ldexp(pixelDc, ivec2(zoomExp-s));
+			if (max(abs(w.x), abs(w.y)) > 65536.0f) {
+				w = ldexp(w, ivec2(-16));
+				s += 16;
+			}
+			z = orbit[i+1];
+		}
+		else {
+			w = 2.0f*cmul(Z, w) + cmul(w, w) + dc;
+			z = orbit[i+1] + w;
+		}
+		if (s >= -100 && s != 0) {
+			// dz is large enough for plain floats now
+			w = ldexp(w, ivec2(s));
+			s = 0;
+		}
+		if (dot(z, z) > 4.0) {
+			break;
+		}
+		iters = i;
+		// Pauldelbrot's criterion: z much smaller than Z means dz lost its precision
+		if (s == 0 && dot(z, z) < 1e-6f*dot(orbit[i+1], orbit[i+1])) {
+			glitched = true;
+			break;
+		}
+	}
+	countIterations(min(i+1, maxIters));
+	if (glitched) {
+		if (atomicAdd(glitchCount, 1u) == 0u) glitchPos = pixelPos;
+		FragColour = vec4(0.0f, 0.0f, 0.0f, 0.0f);
+		return;
+	}
+	float t;
+	if (iters == maxIters-1.0f) t = 1.0f;
+	else t = float(iters % banding)/float(banding);
+	float r = c1.x + t*(c2.x-c1.x);
+	float g = c1.y + t*(c2.y-c1.y);
+	float b = c1.z + t*(c2.z-c1.z);
+	FragColour = vec4(r, g, b, 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 460 core
+layout (location=0) in vec3 aPos;
+
+// offset of c from the reference point, in units of 2^zoomExp
+out vec2 dcUnit;
+// offset of c from pos in the same units, reported back for glitched pixels
+out vec2 posUnit;
+uniform float zoomMantissa;
+uniform vec2 refOffset;
+uniform mat4 mat;
+uniform mat4 effectMat;
+
+void main() {
+	posUnit = zoomMantissa*(effectMat*vec4(aPos, 1.0f)).xy;
+	dcUnit = posUnit - refOffset;
+	gl_Position = mat*vec4(aPos, 1.0f);
+}
\ No newline at end of file
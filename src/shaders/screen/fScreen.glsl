@@ -3,7 +3,55 @@ out vec4 FragColor;
 in vec2 uv;
 
 uniform sampler2D screenTex;
+// the part of the render targets this frame drew into (dynamic resolution) and the window size
+uniform vec2 renderSize;
+uniform vec2 screenSize;
+// scales the colour, 1/samples when showing the refinement accumulation buffer
+uniform float weight;
+
+// recolour path: colours come from the iteration buffer written by fShader32Iters.glsl
+uniform bool recolour;
+uniform usampler2D itersTex;
+uniform sampler1D palette;
+uniform int maxIters;
+uniform vec3 interior;
+uniform bool smoothColour;
+uniform float paletteOffset;
+
+vec3 colourOf(uint v) {
+    // cleared value, the cube does not cover this texel
+    if (v == 0xFFFFFFFFu) return vec3(0.0);
+    uint iters = v >> 8;
+    // counts from a pass with a higher maxIters than now are past the current limit
+    if (maxIters > 0 && iters >= uint(maxIters-1)) return interior;
+    float size = float(textureSize(palette, 0));
+    float idx = float(iters) + paletteOffset;
+    if (smoothColour) idx += float(v & 255u)/255.0;
+    float i0 = floor(idx);
+    vec3 a = texelFetch(palette, int(mod(i0, size)), 0).rgb;
+    if (!smoothColour) return a;
+    vec3 b = texelFetch(palette, int(mod(i0 + 1.0, size)), 0).rgb;
+    return mix(a, b, idx - i0);
+}
 
 void main() {
-    FragColor = texture(screenTex, uv);
+    if (!recolour) {
+        // kept half a texel inside the drawn part so linear filtering does not pick up stale texels
+        vec2 texSize = vec2(textureSize(screenTex, 0));
+        vec2 st = clamp(uv*renderSize, vec2(0.5), renderSize - 0.5);
+        FragColor = vec4(texture(screenTex, st/texSize).rgb*weight, 1.0);
+        return;
+    }
+    // box filter over the texels behind this pixel, ssaa x ssaa of them at full resolution
+    vec2 ratio = renderSize/screenSize;
+    int n = clamp(int(ceil(max(ratio.x, ratio.y) - 0.001)), 1, 8);
+    vec2 base = floor(gl_FragCoord.xy);
+    vec3 sum = vec3(0.0);
+    for (int j=0; j<n; j++) {
+        for (int i=0; i<n; i++) {
+            ivec2 texel = ivec2((base + (vec2(i, j) + 0.5)/float(n))*ratio);
+            sum += colourOf(texelFetch(itersTex, min(texel, ivec2(renderSize) - 1), 0).r);
+        }
+    }
+    FragColor = vec4(sum/float(n*n)*weight, 1.0);
 }
\ No newline at end of file
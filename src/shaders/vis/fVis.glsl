@@ -0,0 +1,13 @@
+#version 460 core
+// visibility buffer: the cube pass only stores what the escape kernels need, the kernels then run once per
+// covered pixel in a full screen pass (vResolve.glsl with the usual fragment shader)
+layout(location=0) out vec4 Vis;
+// screen space derivatives of unit, for the sub-samples of adaptive supersampling
+layout(location=1) out vec4 VisDeriv;
+in vec2 unit;
+
+void main() {
+	// face 1-6 (0 is left for uncovered pixels), two triangles per face in cube[]
+	Vis = vec4(unit, float(gl_PrimitiveID/2 + 1), 1.0f);
+	VisDeriv = vec4(dFdxFine(unit), dFdyFine(unit));
+}
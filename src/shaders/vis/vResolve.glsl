@@ -0,0 +1,17 @@
+#version 460 core
+layout (location=0) in vec3 aPos;
+
+// full screen pass over the visibility buffer; the fragment shaders read c from there when resolve is
+// set, these outputs only exist so the programs link
+out vec4 FragPos;
+out vec2 unit;
+out vec2 dcUnit;
+out vec2 posUnit;
+
+void main() {
+	FragPos = vec4(0.0f);
+	unit = vec2(0.0f);
+	dcUnit = vec2(0.0f);
+	posUnit = vec2(0.0f);
+	gl_Position = vec4(aPos, 1.0f);
+}
@@ -0,0 +1,12 @@
+#version 460 core
+layout (location=0) in vec3 aPos;
+
+// offset of c from pos in units of zoom, as in vShaderDF.glsl
+out vec2 unit;
+uniform mat4 mat;
+uniform mat4 effectMat;
+
+void main() {
+	unit = (effectMat*vec4(aPos, 1.0f)).xy;
+	gl_Position = mat*vec4(aPos, 1.0f);
+}